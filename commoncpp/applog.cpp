@@ -44,6 +44,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
 #include <string>
 #include <iomanip>
 #include <iostream>
@@ -62,6 +68,8 @@
 
 namespace ost {
 
+class logRing;
+
 class logStruct
 {
   public:
@@ -72,6 +80,7 @@ class logStruct
     bool         _clogEnable;
     bool         _slogEnable;
     size_t       _msgpos;
+    logRing      *_ring;
 
     enum logEnum
     {
@@ -82,7 +91,7 @@ class logStruct
 
     logStruct() :  _ident("") ,  _priority(Slog::levelDebug),
         _level(Slog::levelDebug), _enable(false),
-        _clogEnable(false), _slogEnable(false), _msgpos(0)
+        _clogEnable(false), _slogEnable(false), _msgpos(0), _ring(NULL)
     {
       memset(_msgbuf, 0, BUFF_SIZE);
     };
@@ -122,6 +131,7 @@ class logger : public ost::ThreadQueue
   protected:
     // to dequeue log messages and write them to file if not log_directly
     virtual void  runQueue(void *data);
+    virtual void  runQueue(void **data, unsigned count);
     virtual void  startQueue(void);
     virtual void  stopQueue(void);
     virtual void  onTimer(void);
@@ -140,11 +150,193 @@ class logger : public ost::ThreadQueue
 
 };
 
+#ifndef HAVE_SYS_UIO_H
+struct iovec
+{
+  void   *iov_base;
+  size_t iov_len;
+};
+#endif
+
+// single producer, single consumer ring of formatted log records.  The
+// ring is owned by one subscribed thread and drained by the spooler.
+class logRing
+{
+  public:
+    logRing       *_next;
+    bool          _used;
+
+    // producer side, also holds cached timestamp of last second logged
+    ucommon::Atomic::counter _tail;
+    time_t        _second;
+    char          _stamp[24];
+
+    char          _pad[64];
+
+    // consumer side
+    ucommon::Atomic::counter _head;
+    unsigned      _mask;
+    char          *_buf;
+
+    logRing(unsigned size) : _next(NULL), _used(true), _tail(0), _second(0), _head(0)
+    {
+      _mask = size - 1;
+      _buf = new char[size];
+      _stamp[0] = 0;
+    };
+
+    ~logRing()
+    {
+      delete[] _buf;
+    };
+
+    // format "yyyy-mm-dd hh:mm:ss.mmm ", only calling localtime once a second
+    size_t stamp(char *buf)
+    {
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      if (now.tv_sec != _second)
+      {
+        struct tm dt;
+        time_t sec = now.tv_sec;
+        ost::localtime_r(&sec, &dt);
+        // fields are bounded so the stamp is always 20 characters
+        snprintf(_stamp, sizeof(_stamp), "%04u-%02u-%02u %02u:%02u:%02u.",
+                 (unsigned)(dt.tm_year + 1900) % 10000u, (unsigned)(dt.tm_mon + 1) % 100u,
+                 (unsigned)dt.tm_mday % 100u, (unsigned)dt.tm_hour % 100u,
+                 (unsigned)dt.tm_min % 100u, (unsigned)dt.tm_sec % 100u);
+        _second = now.tv_sec;
+      }
+      unsigned ms = (unsigned)(now.tv_usec / 1000);
+      memcpy(buf, _stamp, 20);
+      buf[20] = (char)('0' + ms / 100);
+      buf[21] = (char)('0' + (ms / 10) % 10);
+      buf[22] = (char)('0' + ms % 10);
+      buf[23] = ' ';
+      return 24;
+    };
+
+    size_t avail(void)
+    {
+      return (_mask + 1) - ((unsigned)_tail.get() - (unsigned)_head.get());
+    };
+
+    // copy data into ring, caller checks for space first
+    void put(const char *data, size_t len)
+    {
+      unsigned pos = (unsigned)_tail.get() & _mask;
+      size_t first = (_mask + 1) - pos;
+      if (first > len)
+        first = len;
+      memcpy(_buf + pos, data, first);
+      if (len > first)
+        memcpy(_buf, data + first, len - first);
+    };
+
+    void commit(size_t len)
+    {
+      _tail.fetch_add((atomic_t)len);
+    };
+
+    // waiting data as up to two io vectors
+    unsigned get(struct iovec *iov, size_t *len)
+    {
+      unsigned head = (unsigned)_head.get();
+      *len = (unsigned)_tail.get() - head;
+      if (!*len)
+        return 0;
+      unsigned pos = head & _mask;
+      size_t first = (_mask + 1) - pos;
+      if (first >= *len)
+      {
+        iov[0].iov_base = _buf + pos;
+        iov[0].iov_len = *len;
+        return 1;
+      }
+      iov[0].iov_base = _buf + pos;
+      iov[0].iov_len = first;
+      iov[1].iov_base = _buf;
+      iov[1].iov_len = *len - first;
+      return 2;
+    };
+
+    void release(size_t len)
+    {
+      _head.fetch_add((atomic_t)len);
+    };
+};
+
+// drains the rings of all subscribed threads into the log file
+class ringSpooler : public ucommon::JoinableThread
+{
+  private:
+    Mutex               _lock;
+    ucommon::TimedEvent _event;
+    logRing             *_rings;
+    unsigned            _size;
+    volatile bool       _running;
+    volatile bool       _idle;
+    bool                _closed;
+    bool                _pipe;
+    string              _name;
+    int                 _fd;
+
+    enum
+    {
+      RING_SIZE = 65536,
+      RING_BATCH = 64
+    };
+
+    void run(void);
+    size_t drain(void);
+    void output(struct iovec *iov, unsigned count);
+
+  public:
+    ringSpooler(const char *name, bool pipe, size_t size);
+    ~ringSpooler();
+
+    logRing *attach(void);
+    void detach(logRing *ring);
+    void write(logRing *ring, const char *data, size_t len);
+    void logFileName(const char *name, bool pipe);
+    void openFile(void);
+    void closeFile(void);
+};
+
 // mapping thread ID <-> logStruct (buffer)
 typedef std::map <cctid_t, logStruct> LogPrivateData;
 // map ident <-> levels
 typedef std::map <string, Slog::Level> IdentLevel;
 
+// each thread caches its buffer for the last log it wrote to, so the
+// thread map is only searched when a thread first writes to a log.
+class __LOCAL logCache
+{
+  public:
+    unsigned long _serial;
+    logStruct    *_log;
+};
+
+class __LOCAL logLocal : public ucommon::Thread::Local
+{
+  private:
+    void release(void *instance)
+    {
+      delete static_cast<logCache *>(instance);
+    }
+
+    void *allocate()
+    {
+      logCache *cache = new logCache;
+      cache->_serial = 0;
+      cache->_log = NULL;
+      return cache;
+    }
+};
+
+static logLocal logCaches;
+static ucommon::Atomic::counter logSerials;
+
 class __LOCAL AppLogPrivate
 {
   public:
@@ -159,6 +351,8 @@ class __LOCAL AppLogPrivate
     bool           _logPipe;
     // log spooler
     logger         *_pLogger;
+    // per thread ring spooler
+    ringSpooler    *_pSpooler;
 
     string        _nomeFile;
     Mutex         _lock;
@@ -167,10 +361,42 @@ class __LOCAL AppLogPrivate
     static const levelNamePair _values[];
     static LevelName           _assoc;
 
-    AppLogPrivate() : _pLogger(NULL) {}
+    // identifies this log in thread caches
+    unsigned long _serial;
+
+    AppLogPrivate() : _pLogger(NULL), _pSpooler(NULL)
+    {
+      _serial = (unsigned long)++logSerials;
+    }
+
+    // buffer of the calling thread, or NULL if not subscribed
+    logStruct *find(cctid_t tid)
+    {
+      logCache *cache = static_cast<logCache *>(*logCaches);
+      if (cache->_serial == _serial)
+        return cache->_log;
+
+      LogPrivateData::iterator logIt = _logs.find(tid);
+      if (logIt == _logs.end())
+        return NULL;
+
+      cache->_serial = _serial;
+      cache->_log = &logIt->second;
+      return cache->_log;
+    }
+
+    // called by a thread before its buffer is removed
+    void forget(void)
+    {
+      logCache *cache = static_cast<logCache *>(logCaches.get());
+      if (cache && cache->_serial == _serial)
+        cache->_serial = 0;
+    }
 
     ~AppLogPrivate()
     {
+      if (_pSpooler)
+        delete _pSpooler;
       if (_pLogger)
         delete _pLogger;
     }
@@ -295,6 +521,7 @@ logger::logger(const char* logFileName, bool usePipe)  : ThreadQueue(NULL, 0, 0)
   if (logFileName)
     _nomeFile = logFileName;
  
+  setPooling();
   openFile();
 }
 
@@ -400,6 +627,33 @@ void logger::runQueue(void * data)
   }
 }
 
+// writes a batch of enqueued messages with a single flush
+void logger::runQueue(void **data, unsigned count)
+{
+  try
+  {
+    _openFile();
+  }
+  catch (AppLogException e)
+  {
+    std::cerr << e.what() << std::endl;
+    slog.emerg("%s\n", e.what());
+    std::cerr.flush();
+  }
+
+  if (_logfs.is_open())
+  {
+    for (unsigned i = 0; i < count; i++)
+      _logfs << (char *) data[i];
+    _logfs.flush();
+  }
+
+  if ((_usePipe || _closedByApplog) && _logfs.is_open())
+  {
+    _logfs.close();
+  }
+}
+
 void logger::startQueue()
 {
 }
@@ -425,6 +679,224 @@ void logger::final()
   }
 }
 
+// class ringSpooler
+ringSpooler::ringSpooler(const char *name, bool pipe, size_t size) :
+  JoinableThread(), _rings(NULL), _running(true), _idle(false),
+  _closed(false), _pipe(pipe), _name(name), _fd(-1)
+{
+  _size = 4096;
+  if (!size)
+    size = RING_SIZE;
+  while (_size < size)
+    _size <<= 1;
+
+  start();
+}
+
+ringSpooler::~ringSpooler()
+{
+  _running = false;
+  _event.signal();
+  join();
+
+  drain();
+  if (_fd > -1)
+    ::close(_fd);
+
+  while (_rings)
+  {
+    logRing *next = _rings->_next;
+    delete _rings;
+    _rings = next;
+  }
+}
+
+logRing *ringSpooler::attach(void)
+{
+  MutexLock lock(_lock);
+  logRing *ring = _rings;
+
+  // re-use ring of an unsubscribed thread once it has been drained
+  while (ring)
+  {
+    if (!ring->_used && ring->_tail.get() == ring->_head.get())
+      break;
+    ring = ring->_next;
+  }
+
+  if (ring)
+  {
+    ring->_used = true;
+    return ring;
+  }
+
+  ring = new logRing(_size);
+  ring->_next = _rings;
+  _rings = ring;
+  return ring;
+}
+
+void ringSpooler::detach(logRing *ring)
+{
+  MutexLock lock(_lock);
+  ring->_used = false;
+}
+
+void ringSpooler::write(logRing *ring, const char *data, size_t len)
+{
+  // a record larger than the ring is truncated rather than lost
+  if (len > _size)
+    len = _size;
+
+  while (ring->avail() < len)
+  {
+    if (!_running)
+      return;
+    _event.signal();
+    Thread::yield();
+  }
+
+  ring->put(data, len);
+  ring->commit(len);
+
+  if (_idle)
+    _event.signal();
+}
+
+void ringSpooler::logFileName(const char *name, bool pipe)
+{
+  MutexLock lock(_lock);
+  if (_fd > -1)
+    ::close(_fd);
+  _fd = -1;
+  _name = name;
+  _pipe = pipe;
+  _closed = false;
+}
+
+void ringSpooler::openFile(void)
+{
+  _closed = false;
+}
+
+void ringSpooler::closeFile(void)
+{
+  _closed = true;
+}
+
+void ringSpooler::output(struct iovec *iov, unsigned count)
+{
+  if (_fd < 0 && !_name.empty())
+  {
+#ifndef _MSWINDOWS_
+    if (_pipe)
+    {
+      int err = mkfifo(_name.c_str(), S_IRUSR | S_IWUSR);
+      if (err == 0 || errno == EEXIST)
+        _fd = ::open(_name.c_str(), O_RDWR);
+    }
+    else
+#endif
+      _fd = ::open(_name.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0640);
+  }
+
+  if (_fd < 0)
+    return;
+
+#ifdef HAVE_SYS_UIO_H
+  while (count)
+  {
+    ssize_t result = ::writev(_fd, iov, (int)count);
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result <= 0)
+      break;
+    while (count && (size_t)result >= iov->iov_len)
+    {
+      result -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count)
+    {
+      iov->iov_base = (char *)iov->iov_base + result;
+      iov->iov_len -= result;
+    }
+  }
+#else
+  for (unsigned pos = 0; pos < count; ++pos)
+    ::write(_fd, iov[pos].iov_base, (unsigned)iov[pos].iov_len);
+#endif
+}
+
+// collect waiting records of every ring into one gathered write
+size_t ringSpooler::drain(void)
+{
+  struct iovec iov[RING_BATCH * 2];
+  logRing *rings[RING_BATCH];
+  size_t sizes[RING_BATCH];
+  unsigned count, index;
+  size_t total = 0;
+
+  MutexLock lock(_lock);
+  logRing *ring = _rings;
+
+  while (ring)
+  {
+    count = index = 0;
+    while (ring && index < RING_BATCH)
+    {
+      unsigned used = ring->get(&iov[count], &sizes[index]);
+      if (used)
+      {
+        rings[index++] = ring;
+        count += used;
+      }
+      ring = ring->_next;
+    }
+
+    if (!index)
+      break;
+
+    output(iov, count);
+
+    while (index)
+    {
+      --index;
+      rings[index]->release(sizes[index]);
+      total += sizes[index];
+    }
+  }
+
+  // if we use a pipe to avoid blocking without a consumer, or the
+  // log was closed, we only keep the file open while writing
+  if ((_pipe || _closed) && _fd > -1)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+
+  return total;
+}
+
+void ringSpooler::run(void)
+{
+  while (_running)
+  {
+    if (drain())
+      continue;
+
+    _idle = true;
+    if (drain())
+    {
+      _idle = false;
+      continue;
+    }
+    _event.wait(50);
+    _idle = false;
+  }
+}
+
 #ifndef _MSWINDOWS_
 AppLog::AppLog(const char* logFileName, bool logDirectly, bool usePipe) :
     streambuf(), ostream((streambuf*) this)
@@ -538,7 +1010,12 @@ void AppLog::unsubscribe()
     LogPrivateData::iterator logIt = d->_logs.find(tid);
     if (logIt != d->_logs.end())
     {
+      // ring may be re-used by a later thread once drained
+      if (logIt->second._ring && d->_pSpooler)
+        d->_pSpooler->detach(logIt->second._ring);
+
       // unsubscribes thread
+      d->forget();
       d->_logs.erase(logIt);
     }
   }
@@ -572,6 +1049,9 @@ void AppLog::logFileName(const char* FileName, bool logDirectly)
     else
       d->_pLogger = new logger(FileName, d->_logPipe);
 
+    if (d->_pSpooler)
+      d->_pSpooler->logFileName(FileName, d->_logPipe);
+
     d->_lock.leaveMutex();
     return;
   }
@@ -603,6 +1083,30 @@ void AppLog::logFileName(const char* FileName, bool logDirectly)
   d->_lock.leaveMutex();
 }
 
+static void logTime(char *buf, size_t size)
+{
+  time_t now;
+  struct tm *dt;
+  time(&now);
+  struct timeval detail_time;
+  gettimeofday(&detail_time, NULL);
+  dt = localtime(&now);
+
+  snprintf(buf, size - 1, "%04d-%02d-%02d %02d:%02d:%02d.%03d ",
+           dt->tm_year + 1900, dt->tm_mon + 1, dt->tm_mday,
+           dt->tm_hour, dt->tm_min, dt->tm_sec, (int)(detail_time.tv_usec / 1000));
+
+  buf[size - 1] = 0;    // per sicurezza
+}
+
+void AppLog::logAsync(size_t size)
+{
+  d->_lock.enterMutex();
+  if (!d->_pSpooler && !d->_logDirectly && !d->_nomeFile.empty())
+    d->_pSpooler = new ringSpooler(d->_nomeFile.c_str(), d->_logPipe, size);
+  d->_lock.leaveMutex();
+}
+
 // writes to log
 void AppLog::writeLog(bool endOfLine)
 {
@@ -611,31 +1115,23 @@ void AppLog::writeLog(bool endOfLine)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
-    if ((d->_logDirectly && !d->_logfs.is_open() && !logIt->second._clogEnable) ||
-        (!d->_logDirectly && !d->_pLogger && !logIt->second._clogEnable))
+    if ((d->_logDirectly && !d->_logfs.is_open() && !pLog->_clogEnable) ||
+        (!d->_logDirectly && !d->_pLogger && !pLog->_clogEnable))
 
     {
-      logIt->second._msgpos = 0;
-      logIt->second._msgbuf[0] = '\0';
+      pLog->_msgpos = 0;
+      pLog->_msgbuf[0] = '\0';
       return;
     }
 
-    if (logIt->second._enable)
+    if (pLog->_enable)
     {
-      time_t now;
-      struct tm *dt;
-      time(&now);
-      struct timeval detail_time;
-      gettimeofday(&detail_time, NULL);
-      dt = localtime(&now);
-      char buf[50];
-
       const char *p = "unknown";
-      switch (logIt->second._priority)
+      switch (pLog->_priority)
       {
         case Slog::levelEmergency:
           p = "emerg";
@@ -663,23 +1159,70 @@ void AppLog::writeLog(bool endOfLine)
           break;
       }
 
-      snprintf(buf, sizeof(buf) - 1, "%04d-%02d-%02d %02d:%02d:%02d.%03d ",
-               dt->tm_year + 1900, dt->tm_mon + 1, dt->tm_mday,
-               dt->tm_hour, dt->tm_min, dt->tm_sec, (int)(detail_time.tv_usec / 1000));
+      if (!d->_logDirectly && d->_pSpooler)
+      {
+        // format record straight into this thread's ring, the stamp
+        // prefix is cached per second by the ring
+        logStruct& log = *pLog;
+        char rec[24 + 64 + 2 + 10 + logStruct::BUFF_SIZE + 1];
+        size_t len, pos;
+
+        if (!log._ring)
+          log._ring = d->_pSpooler->attach();
+
+        pos = log._ring->stamp(rec);
+        if (!log._ident.empty())
+        {
+          len = log._ident.length();
+          if (len > 64)
+            len = 64;
+          memcpy(rec + pos, log._ident.c_str(), len);
+          pos += len;
+          rec[pos++] = ':';
+          rec[pos++] = ' ';
+        }
+        rec[pos++] = '[';
+        len = strlen(p);
+        memcpy(rec + pos, p, len);
+        pos += len;
+        rec[pos++] = ']';
+        rec[pos++] = ' ';
+        len = strlen(log._msgbuf);
+        memcpy(rec + pos, log._msgbuf, len);
+        pos += len;
+        if (endOfLine)
+          rec[pos++] = '\n';
 
-      buf[sizeof(buf)-1] = 0;    // per sicurezza
+        d->_pSpooler->write(log._ring, rec, pos);
 
-      if (d->_logDirectly)
+        bool slogIt = log._slogEnable && log._priority <= Slog::levelError;
+        bool clogIt = log._clogEnable;
+#ifndef _MSWINDOWS_
+        if (clogIt && getppid() <= 1)
+          clogIt = false;
+#endif
+        if (!slogIt && !clogIt)
+        {
+          log._msgpos = 0;
+          log._msgbuf[0] = '\0';
+          return;
+        }
+        d->_lock.enterMutex();
+      }
+      else if (d->_logDirectly)
       {
+        char buf[50];
+        logTime(buf, sizeof(buf));
+
         d->_lock.enterMutex();
         if (d->_logfs.is_open())
         {
           d->_logfs << buf;
-          if (!logIt->second._ident.empty())
-            d->_logfs << logIt->second._ident.c_str() << ": ";
+          if (!pLog->_ident.empty())
+            d->_logfs << pLog->_ident.c_str() << ": ";
           d->_logfs << "[" << p << "] ";
 
-          d->_logfs << logIt->second._msgbuf;
+          d->_logfs << pLog->_msgbuf;
 
           if (endOfLine)
             d->_logfs << endl;
@@ -689,16 +1232,19 @@ void AppLog::writeLog(bool endOfLine)
       }
       else if (d->_pLogger)
       {
+        char buf[50];
+        logTime(buf, sizeof(buf));
+
         // ThreadQueue
         std::stringstream sstr;
         sstr.str("");    // reset contents
         sstr << buf;
 
-        if (!logIt->second._ident.empty())
-          sstr << logIt->second._ident.c_str() << ": ";
+        if (!pLog->_ident.empty())
+          sstr << pLog->_ident.c_str() << ": ";
         sstr << "[" << p << "] ";
 
-        sstr << logIt->second._msgbuf;
+        sstr << pLog->_msgbuf;
         if (endOfLine)
           sstr << endl;
         sstr.flush();
@@ -713,18 +1259,18 @@ void AppLog::writeLog(bool endOfLine)
       }
 
       // slog it if error level is right
-      if (logIt->second._slogEnable && logIt->second._priority <= Slog::levelError)
+      if (pLog->_slogEnable && pLog->_priority <= Slog::levelError)
       {
-        slog((Slog::Level) logIt->second._priority) << logIt->second._msgbuf;
+        slog((Slog::Level) pLog->_priority) << pLog->_msgbuf;
         if (endOfLine) slog << endl;
       }
-      if (logIt->second._clogEnable
+      if (pLog->_clogEnable
 #ifndef _MSWINDOWS_
           && (getppid() > 1)
 #endif
          )
       {
-        clog << logIt->second._msgbuf;
+        clog << pLog->_msgbuf;
         if (endOfLine)
           clog << endl;
       }
@@ -732,8 +1278,8 @@ void AppLog::writeLog(bool endOfLine)
       d->_lock.leaveMutex();
     }
 
-    logIt->second._msgpos = 0;
-    logIt->second._msgbuf[0] = '\0';
+    pLog->_msgpos = 0;
+    pLog->_msgbuf[0] = '\0';
   }
 }
 
@@ -753,6 +1299,8 @@ void AppLog::close(void)
   {
     if (d->_pLogger)
       d->_pLogger->closeFile();
+    if (d->_pSpooler)
+      d->_pSpooler->closeFile();
   }
 }
 
@@ -763,8 +1311,8 @@ void AppLog::open(const char *ident)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     if (d->_nomeFile.empty())
@@ -790,9 +1338,11 @@ void AppLog::open(const char *ident)
     {
       if (d->_pLogger)
       	d->_pLogger->openFile();
+      if (d->_pSpooler)
+        d->_pSpooler->openFile();
     }
     if (ident != NULL)
-      logIt->second._ident = ident;
+      pLog->_ident = ident;
 
   }
 }
@@ -821,10 +1371,10 @@ void AppLog::level(Slog::Level enable)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
-    logIt->second._level = enable;
+    pLog->_level = enable;
   }
 }
 
@@ -835,10 +1385,10 @@ void AppLog::clogEnable(bool f)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
-    logIt->second._clogEnable = f;
+    pLog->_clogEnable = f;
   }
 }
 
@@ -849,11 +1399,11 @@ void AppLog::slogEnable(bool en)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
-    logIt->second._slogEnable = en;
+    pLog->_slogEnable = en;
   }
 }
 
@@ -871,10 +1421,10 @@ int AppLog::sync()
   if (pThr)
   {
     cctid_t tid =  pThr->getId();
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt != d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (pLog)
     {
-      retVal = (logIt->second._msgpos > 0);
+      retVal = (pLog->_msgpos > 0);
       if (retVal)
       {
         slog(Slog::levelNotice) << "sync called and msgpos > 0" << endl;
@@ -895,33 +1445,33 @@ int AppLog::overflow(int c)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return c;
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return c;
 
     if (c == '\n' || !c || c == EOF)
     {
-      if (!logIt->second._msgpos)
+      if (!pLog->_msgpos)
       {
         if (c == '\n') writeLog(true);
         return c;
       }
-      if (logIt->second._msgpos < (int)(sizeof(logIt->second._msgbuf) - 1))
-        logIt->second._msgbuf[logIt->second._msgpos] = 0;
+      if (pLog->_msgpos < (int)(sizeof(pLog->_msgbuf) - 1))
+        pLog->_msgbuf[pLog->_msgpos] = 0;
       else
-        logIt->second._msgbuf[logIt->second._msgpos-1] = 0;
+        pLog->_msgbuf[pLog->_msgpos-1] = 0;
 
       writeLog(c == '\n');
       //reset buffer
-      logIt->second._msgpos = 0;
+      pLog->_msgpos = 0;
 
       return c;
     }
 
-    if (logIt->second._msgpos < (int)(sizeof(logIt->second._msgbuf) - 1))
-      logIt->second._msgbuf[logIt->second._msgpos++] = c;
+    if (pLog->_msgpos < (int)(sizeof(pLog->_msgbuf) - 1))
+      pLog->_msgbuf[pLog->_msgpos++] = c;
 
   }
 
@@ -937,22 +1487,22 @@ void AppLog::error(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     error();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
-    if (logIt->second._slogEnable)
-      slog.error(logIt->second._msgbuf);
+    if (pLog->_slogEnable)
+      slog.error(pLog->_msgbuf);
     va_end(args);
   }
 }
@@ -966,22 +1516,22 @@ void AppLog::warn(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     warn();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
-    if (logIt->second._slogEnable)
-      slog.warn(logIt->second._msgbuf);
+    if (pLog->_slogEnable)
+      slog.warn(pLog->_msgbuf);
     va_end(args);
   }
 }
@@ -995,19 +1545,19 @@ void AppLog::debug(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     debug();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
     va_end(args);
   }
@@ -1022,22 +1572,22 @@ void AppLog::emerg(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     emerg();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
-    if (logIt->second._slogEnable)
-      slog.emerg(logIt->second._msgbuf);
+    if (pLog->_slogEnable)
+      slog.emerg(pLog->_msgbuf);
     va_end(args);
   }
 }
@@ -1051,22 +1601,22 @@ void AppLog::alert(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     alert();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
-    if (logIt->second._slogEnable)
-      slog.alert(logIt->second._msgbuf);
+    if (pLog->_slogEnable)
+      slog.alert(pLog->_msgbuf);
     va_end(args);
   }
 }
@@ -1080,22 +1630,22 @@ void AppLog::critical(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     critical();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
-    if (logIt->second._slogEnable)
-      slog.critical(logIt->second._msgbuf);
+    if (pLog->_slogEnable)
+      slog.critical(pLog->_msgbuf);
     va_end(args);
   }
 }
@@ -1109,22 +1659,22 @@ void AppLog::notice(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     notice();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
-    if (logIt->second._slogEnable)
-      slog.notice(logIt->second._msgbuf);
+    if (pLog->_slogEnable)
+      slog.notice(pLog->_msgbuf);
     va_end(args);
   }
 }
@@ -1138,19 +1688,19 @@ void AppLog::info(const char *format, ...)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return;
 
     info();
-    if (!logIt->second._enable)
+    if (!pLog->_enable)
       return;
     overflow(EOF);
 
     va_start(args, format);
-    logIt->second._msgbuf[logStruct::BUFF_SIZE-1] = '\0';
-    logIt->second._msgpos = vsnprintf(logIt->second._msgbuf, logStruct::BUFF_SIZE, format, args);
-    if (logIt->second._msgpos > logStruct::BUFF_SIZE - 1) logIt->second._msgpos = logStruct::BUFF_SIZE - 1;
+    pLog->_msgbuf[logStruct::BUFF_SIZE-1] = '\0';
+    pLog->_msgpos = vsnprintf(pLog->_msgbuf, logStruct::BUFF_SIZE, format, args);
+    if (pLog->_msgpos > logStruct::BUFF_SIZE - 1) pLog->_msgpos = logStruct::BUFF_SIZE - 1;
     overflow(EOF);
     va_end(args);
   }
@@ -1163,28 +1713,28 @@ AppLog &AppLog::operator()(Slog::Level lev)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return *this;
 
     // needed? overflow(EOF);
 
     // enables log
-    Slog::Level th_lev = logIt->second._level;
-    logIt->second._enable = (th_lev >= lev);
+    Slog::Level th_lev = pLog->_level;
+    pLog->_enable = (th_lev >= lev);
     // is there a log level per module?
-    if (!logIt->second._ident.empty())
+    if (!pLog->_ident.empty())
     {
-      std::string st = logIt->second._ident;
+      std::string st = pLog->_ident;
       IdentLevel::iterator idLevIt = d->_identLevel.find(st);
       if (idLevIt != d->_identLevel.end())
       {
         th_lev = idLevIt->second;
-        logIt->second._enable = (th_lev >= lev);
+        pLog->_enable = (th_lev >= lev);
       }
     }
 
-    logIt->second._priority = lev;
+    pLog->_priority = lev;
   }
 
   return *this;
@@ -1197,11 +1747,11 @@ AppLog &AppLog::operator()(const char *ident, Slog::Level lev)
   {
     cctid_t tid =  pThr->getId();
 
-    LogPrivateData::iterator logIt = d->_logs.find(tid);
-    if (logIt == d->_logs.end())
+    logStruct *pLog = d->find(tid);
+    if (!pLog)
       return this->operator()(lev);
 
-    logIt->second._enable =  true;
+    pLog->_enable =  true;
     open(ident);
   }
 
@@ -107,19 +107,55 @@ void *Assoc::getPointer(const char *id) const
 
 SharedMemPager::SharedMemPager(size_t pg) :
 MemPager(pg), Mutex()
-{}
+{
+}
+
+void SharedMemPager::caching(size_t size)
+{
+    if(!size)
+        size = (memalloc::size() - sizeof(void *) * 4) / 4;
+
+    arenas.enable(size);
+}
 
 void SharedMemPager::purge(void)
 {
     enterMutex();
+    arenas.invalidate();
     MemPager::purge();
     leaveMutex();
 }
 
+unsigned SharedMemPager::utilization(void)
+{
+    unsigned long used, alloc;
+    unsigned result;
+
+    enterMutex();
+    memalloc::usage(used, alloc);
+    result = arenas.utilization(used, alloc);
+    leaveMutex();
+    return result;
+}
+
 void *SharedMemPager::alloc(size_t size)
 {
     void *mem;
 
+    if(arenas.size()) {
+        while(size % sizeof(void *))
+            ++size;
+        if(arenas.fits(size)) {
+            mem = arenas.get(size);
+            if(mem)
+                return mem;
+            enterMutex();
+            mem = arenas.refill(MemPager::alloc(arenas.size()), size);
+            leaveMutex();
+            return mem;
+        }
+    }
+
     enterMutex();
     mem = MemPager::alloc(size);
     leaveMutex();
@@ -827,12 +827,33 @@ size_t FixedBuffer::onPeek(void *data)
     return objsize;
 }
 
+// smallest queue item size class, and how many free items of each to keep...
+#define QUEUE_MINDATA   64
+#define QUEUE_POOLED    128
+
+static unsigned getClass(unsigned len)
+{
+    unsigned index = 0;
+    unsigned size = QUEUE_MINDATA;
+
+    while(index < QUEUE_CLASSES && len > size) {
+        ++index;
+        size <<= 1;
+    }
+    return index;
+}
+
 ThreadQueue::ThreadQueue(const char *id, int pri, size_t stack) :
 Mutex(), Thread(pri, stack), Semaphore(0), name(id)
 {
     first = last = NULL;
     started = false;
+    pooling = coalesce = idle = false;
     timeout = 0;
+    for(unsigned index = 0; index < QUEUE_CLASSES; ++index) {
+        pool[index] = NULL;
+        pooled[index] = 0;
+    }
 }
 
 ThreadQueue::~ThreadQueue()
@@ -844,9 +865,56 @@ ThreadQueue::~ThreadQueue()
     data = first;
     while(data) {
         next = data->next;
-        delete[] data;
+        delete[] (char *)data;
         data = next;
     }
+    for(unsigned index = 0; index < QUEUE_CLASSES; ++index) {
+        data = pool[index];
+        while(data) {
+            next = data->next;
+            delete[] (char *)data;
+            data = next;
+        }
+    }
+}
+
+ThreadQueue::data_t *ThreadQueue::newData(unsigned len)
+{
+    unsigned index = getClass(len);
+    data_t *data = NULL;
+
+    if(index >= QUEUE_CLASSES)
+        return (data_t *)new char[sizeof(data_t) + len];
+
+    if(pooling) {
+        enterMutex();
+        data = pool[index];
+        if(data) {
+            pool[index] = data->next;
+            --pooled[index];
+        }
+        leaveMutex();
+    }
+
+    // always sized to the class, so any item may be pooled later
+    if(!data)
+        data = (data_t *)new char[sizeof(data_t) + (QUEUE_MINDATA << index)];
+
+    return data;
+}
+
+void ThreadQueue::freeData(data_t *data)
+{
+    unsigned index = getClass(data->len);
+
+    if(!pooling || index >= QUEUE_CLASSES || pooled[index] >= QUEUE_POOLED) {
+        delete[] (char *)data;
+        return;
+    }
+
+    data->next = pool[index];
+    pool[index] = data;
+    ++pooled[index];
 }
 
 void ThreadQueue::run(void)
@@ -855,7 +923,17 @@ void ThreadQueue::run(void)
     data_t *prev;
     started = true;
     for(;;) {
-        posted = Semaphore::wait(timeout);
+        // batches posted while we were busy are taken without waiting,
+        // otherwise we are idle, and posters must wake us
+        posted = false;
+        if(pooling) {
+            enterMutex();
+            posted = (first != NULL);
+            idle = !posted;
+            leaveMutex();
+        }
+        if(!posted)
+            posted = Semaphore::wait(timeout);
         if(!posted) {
             onTimer();
             if(!first)
@@ -864,12 +942,41 @@ void ThreadQueue::run(void)
         if(!started)
             sleep((timeout_t)~0);
         startQueue();
-        while(first) {
+        if(pooling) {
+            void *items[32];
+            unsigned count;
+            data_t *next;
+
+            // take everything waiting under one lock
+            enterMutex();
+            prev = first;
+            first = last = NULL;
+            idle = false;
+            leaveMutex();
+
+            while(prev) {
+                next = prev;
+                count = 0;
+                while(next && count < 32) {
+                    items[count++] = next->data;
+                    next = next->next;
+                }
+                runQueue(items, count);
+                enterMutex();
+                while(prev != next) {
+                    data_t *data = prev;
+                    prev = prev->next;
+                    freeData(data);
+                }
+                leaveMutex();
+            }
+        }
+        else while(first) {
             runQueue(first->data);
             enterMutex();
             prev = first;
             first = first->next;
-            delete[] prev;
+            delete[] (char *)prev;
             if(!first)
                 last = NULL;
             leaveMutex();
@@ -880,6 +987,20 @@ void ThreadQueue::run(void)
     }
 }
 
+void ThreadQueue::runQueue(void **data, unsigned count)
+{
+    for(unsigned index = 0; index < count; ++index)
+        runQueue(data[index]);
+}
+
+void ThreadQueue::setPooling(bool merge)
+{
+    enterMutex();
+    pooling = true;
+    coalesce = merge;
+    leaveMutex();
+}
+
 void ThreadQueue::final()
 {
 }
@@ -903,11 +1024,15 @@ void ThreadQueue::setTimer(timeout_t timed)
 
 void ThreadQueue::post(const void *dp, unsigned len)
 {
-    data_t *data = (data_t *)new char[sizeof(data_t) + len];
+    bool wakeup = true;
+    data_t *data = newData(len);
     memcpy(data->data, dp, len);
     data->len = len;
     data->next = NULL;
     enterMutex();
+    // posts are not counted, so only a busy queue thread can skip them
+    if(coalesce && !idle)
+        wakeup = false;
     if(!first)
         first = data;
     if(last)
@@ -918,7 +1043,8 @@ void ThreadQueue::post(const void *dp, unsigned len)
         started = true;
     }
     leaveMutex();
-    Semaphore::post();
+    if(wakeup)
+        Semaphore::post();
 }
 
 void ThreadQueue::startQueue(void)
@@ -32,6 +32,7 @@ Counted(addr, used), ConditionalAccess()
     Counted **list = get();
 
     head = 0;
+    frozen = false;
     type = arraymode;
     if(type == ARRAY)
         tail = size;
@@ -137,10 +138,36 @@ TypeRef(copy)
 {
 }
 
+ArrayRef::ArrayRef(const typeref_epoch& global) :
+TypeRef()
+{
+    TypeRef::assign(global);
+}
+
+void ArrayRef::writable(void)
+{
+    Array *array = polystatic_cast<Array *>(ref);
+    if(array && array->frozen)
+        resize(array->size);
+}
+
+void ArrayRef::publish(typeref_epoch& target)
+{
+    Array *array = polystatic_cast<Array *>(ref);
+    if(array) {
+        assert(array->type == ARRAY);
+        array->lock();
+        array->frozen = true;
+        array->unlock();
+    }
+    target.set(*this);
+}
+
 void ArrayRef::reset(Counted *object)
 {
     size_t index = 0;
     size_t max;
+    writable();
     Array *array = polystatic_cast<Array *>(ref);
 
     if(!array || !array->size || !object)
@@ -367,6 +394,7 @@ void ArrayRef::pull(TypeRef& object)
 
 void ArrayRef::assign(size_t index, TypeRef& t)
 {
+    writable();
     Array *array = polystatic_cast<Array *>(ref);
     if(!array || index >= array->size)
         return;
@@ -432,6 +460,10 @@ TypeRef::Counted *ArrayRef::get(size_t index)
         return NULL;
 	}
 
+    // published arrays never change
+    if(array->frozen)
+        return array->get(index);
+
     array->lock();
     index += array->head;
     if(array->head <= array->tail && index >= array->tail) {
@@ -451,4 +483,214 @@ TypeRef::Counted *ArrayRef::get(size_t index)
     return object;
 }
 
+RingRef::Ring::Ring(void *addr, size_t used) :
+Counted(addr, used), Conditional(), waiting(0)
+{
+    size_t line = Thread::cache();
+    caddr_t base = (caddr_t)(this) + ((sizeof(Ring) + line - 1) / line) * line;
+
+    // head and tail on their own cache lines, slots follow...
+    head = new(base) Atomic::counter(0);
+    tail = new(base + line) Atomic::counter(0);
+    slots = reinterpret_cast<slot_t *>(base + (2 * line));
+    mask = used - 1;
+
+    for(size_t index = 0; index < used; ++index) {
+        new(&slots[index].sequence) Atomic::counter((atomic_t)index);
+        slots[index].object = NULL;
+    }
+}
+
+void RingRef::Ring::dealloc()
+{
+    Counted *object;
+
+    if(!size)
+        return;
+
+    while(NULL != (object = take()))
+        object->release();
+
+    size = 0;
+    Counted::dealloc();
+}
+
+// positions wrap as unsigned values, so differences are taken unsigned
+// and then compared as signed.
+
+bool RingRef::Ring::put(Counted *object)
+{
+    slot_t *slot;
+    atomic_t pos = tail->get();
+
+    for(;;) {
+        slot = &slots[(unsigned)pos & mask];
+        atomic_t diff = (atomic_t)((unsigned)slot->sequence.get() - (unsigned)pos);
+        if(diff == 0) {
+            if(tail->compare_exchange(pos, (atomic_t)((unsigned)pos + 1)))
+                break;
+        }
+        else if(diff < 0)
+            return false;
+        else
+            pos = tail->get();
+    }
+
+    slot->object = object;
+    slot->sequence.fetch_add(1);
+    return true;
+}
+
+TypeRef::Counted *RingRef::Ring::take(void)
+{
+    slot_t *slot;
+    atomic_t pos = head->get();
+
+    for(;;) {
+        slot = &slots[(unsigned)pos & mask];
+        atomic_t diff = (atomic_t)((unsigned)slot->sequence.get() - ((unsigned)pos + 1));
+        if(diff == 0) {
+            if(head->compare_exchange(pos, (atomic_t)((unsigned)pos + 1)))
+                break;
+        }
+        else if(diff < 0)
+            return NULL;
+        else
+            pos = head->get();
+    }
+
+    Counted *object = slot->object;
+    slot->object = NULL;
+    slot->sequence.fetch_add((atomic_t)mask);
+    return object;
+}
+
+size_t RingRef::Ring::count(void)
+{
+    size_t used = (unsigned)tail->get() - (unsigned)head->get();
+    if(used > size)
+        return size;
+    return used;
+}
+
+void RingRef::Ring::enter(void)
+{
+    atomic_t current = waiting.get();
+    while(!waiting.compare_exchange(current, current + 1))
+        ;
+}
+
+void RingRef::Ring::notify(void)
+{
+    atomic_t none = 0;
+    if(waiting.compare_exchange(none, 0))
+        return;
+
+    lock();
+    broadcast();
+    unlock();
+}
+
+RingRef::RingRef() :
+TypeRef()
+{
+}
+
+RingRef::RingRef(size_t size) :
+TypeRef(create(size))
+{
+}
+
+RingRef::RingRef(const RingRef& copy) :
+TypeRef(copy)
+{
+}
+
+RingRef::Ring *RingRef::create(size_t size)
+{
+    size_t used = 2;
+
+    if(!size)
+        return NULL;
+
+    while(used < size)
+        used <<= 1;
+
+    size_t line = Thread::cache();
+    size_t s = ((sizeof(Ring) + line - 1) / line) * line + (2 * line) + (used * sizeof(Ring::slot_t));
+    caddr_t p = auto_release.allocate(s);
+    return new(mem(p)) Ring(p, used);
+}
+
+size_t RingRef::count(void)
+{
+    Ring *ring = polystatic_cast<Ring *>(ref);
+    if(!ring)
+        return 0;
+
+    return ring->count();
+}
+
+bool RingRef::push(const TypeRef& object, timeout_t timeout)
+{
+    Ring *ring = polystatic_cast<Ring *>(ref);
+    Counted *value = object.ref;
+    bool rtn;
+
+    if(!ring || !value)
+        return false;
+
+    value->retain();
+    rtn = ring->put(value);
+    if(!rtn && timeout) {
+        ring->lock();
+        ring->enter();
+        while(!(rtn = ring->put(value))) {
+            if(timeout == Timer::inf)
+                ring->wait();
+            else if(!ring->wait(timeout))
+                break;
+        }
+        --ring->waiting;
+        ring->unlock();
+    }
+
+    if(!rtn) {
+        value->release();
+        return false;
+    }
+
+    ring->notify();
+    return true;
+}
+
+void RingRef::pull(TypeRef& object, timeout_t timeout)
+{
+    object.clear();
+    Ring *ring = polystatic_cast<Ring *>(ref);
+    Counted *value;
+
+    if(!ring)
+        return;
+
+    value = ring->take();
+    if(!value && timeout) {
+        ring->lock();
+        ring->enter();
+        while(NULL == (value = ring->take())) {
+            if(timeout == Timer::inf)
+                ring->wait();
+            else if(!ring->wait(timeout))
+                break;
+        }
+        --ring->waiting;
+        ring->unlock();
+    }
+
+    if(value) {
+        ring->notify();
+        object.ref = value;
+    }
+}
+
 } // namespace
@@ -0,0 +1,620 @@
+// Copyright (C) 2006-2014 David Sugar, Tycho Softworks.
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon-config.h>
+#include <ucommon/export.h>
+#include <ucommon/thread.h>
+#include <ucommon/fsys.h>
+#include <ucommon/async.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+
+#ifndef _MSWINDOWS_
+#include <unistd.h>
+#endif
+
+#ifdef  HAVE_LINUX_IO_URING_H
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_FEAT_RW_CUR_POS)
+#define USE_URING
+#endif
+
+namespace ucommon {
+
+enum {
+    AIO_READ = 1,
+    AIO_WRITE,
+    AIO_SYNC
+};
+
+class __LOCAL AsyncIO::worker : public JoinableThread
+{
+private:
+    AsyncIO *engine;
+
+public:
+    worker(AsyncIO *io);
+    ~worker();
+
+    void run(void) __OVERRIDE;
+};
+
+AsyncIO::worker::worker(AsyncIO *io) :
+JoinableThread()
+{
+    engine = io;
+}
+
+AsyncIO::worker::~worker()
+{
+    join();
+}
+
+void AsyncIO::worker::run(void)
+{
+    if(engine->uring)
+        engine->reap();
+    else
+        engine->service();
+}
+
+#ifdef  USE_URING
+
+class __LOCAL AsyncIO::ring
+{
+private:
+    __DELETE_COPY(ring);
+
+    caddr_t sqmap, cqmap;
+    size_t sqsize, cqsize, sqesize;
+    struct io_uring_sqe *sqes;
+    unsigned *sqhead, *sqtail, *sqmask, *sqarray;
+    unsigned *cqhead, *cqtail, *cqmask;
+    struct io_uring_cqe *cqes;
+
+public:
+    int fd;
+    unsigned entries, inflight;
+
+    ring(unsigned depth);
+    ~ring();
+
+    bool full(void);
+    bool push(request *req);
+    int enter(unsigned submit, unsigned wait);
+    bool next(request **req, int *result);
+};
+
+AsyncIO::ring::ring(unsigned depth)
+{
+    struct io_uring_params params;
+
+    fd = -1;
+    entries = inflight = 0;
+    sqmap = cqmap = (caddr_t)MAP_FAILED;
+    sqes = (struct io_uring_sqe *)MAP_FAILED;
+
+    memset(&params, 0, sizeof(params));
+    int rfd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if(rfd < 0)
+        return;
+
+    // current file position i/o is needed for offset -1 requests...
+    if(!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        ::close(rfd);
+        return;
+    }
+
+    sqsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqsize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqesize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sqmap = (caddr_t)mmap(NULL, sqsize, PROT_READ | PROT_WRITE, MAP_SHARED, rfd, IORING_OFF_SQ_RING);
+    cqmap = (caddr_t)mmap(NULL, cqsize, PROT_READ | PROT_WRITE, MAP_SHARED, rfd, IORING_OFF_CQ_RING);
+    sqes = (struct io_uring_sqe *)mmap(NULL, sqesize, PROT_READ | PROT_WRITE, MAP_SHARED, rfd, IORING_OFF_SQES);
+
+    if(sqmap == (caddr_t)MAP_FAILED || cqmap == (caddr_t)MAP_FAILED || sqes == (struct io_uring_sqe *)MAP_FAILED) {
+        ::close(rfd);
+        return;
+    }
+
+    sqhead = (unsigned *)(sqmap + params.sq_off.head);
+    sqtail = (unsigned *)(sqmap + params.sq_off.tail);
+    sqmask = (unsigned *)(sqmap + params.sq_off.ring_mask);
+    sqarray = (unsigned *)(sqmap + params.sq_off.array);
+    cqhead = (unsigned *)(cqmap + params.cq_off.head);
+    cqtail = (unsigned *)(cqmap + params.cq_off.tail);
+    cqmask = (unsigned *)(cqmap + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cqmap + params.cq_off.cqes);
+    entries = params.sq_entries;
+    fd = rfd;
+}
+
+AsyncIO::ring::~ring()
+{
+    if(sqes != (struct io_uring_sqe *)MAP_FAILED)
+        munmap(sqes, sqesize);
+    if(cqmap != (caddr_t)MAP_FAILED)
+        munmap(cqmap, cqsize);
+    if(sqmap != (caddr_t)MAP_FAILED)
+        munmap(sqmap, sqsize);
+    if(fd > -1)
+        ::close(fd);
+}
+
+// called with the engine locked
+bool AsyncIO::ring::full(void)
+{
+    unsigned tail = *sqtail;
+    unsigned head = __atomic_load_n(sqhead, __ATOMIC_ACQUIRE);
+
+    // inflight is bounded by the sq size so the cq can never overflow
+    return (tail - head >= entries || inflight >= entries);
+}
+
+// called with the engine locked; a NULL request is a wakeup nop
+bool AsyncIO::ring::push(request *req)
+{
+    if(full())
+        return false;
+
+    unsigned tail = *sqtail;
+
+    unsigned index = tail & *sqmask;
+    struct io_uring_sqe *sqe = &sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uintptr_t)req;
+    if(!req)
+        sqe->opcode = IORING_OP_NOP;
+    else {
+        sqe->fd = req->fd;
+        switch(req->op) {
+        case AIO_READ:
+            sqe->opcode = IORING_OP_READ;
+            break;
+        case AIO_WRITE:
+            sqe->opcode = IORING_OP_WRITE;
+            break;
+        default:
+            // a sync must not start before the writes staged ahead of it
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->flags |= IOSQE_IO_DRAIN;
+            break;
+        }
+        if(req->op != AIO_SYNC) {
+            sqe->addr = (uintptr_t)req->data;
+            sqe->len = (unsigned)req->size;
+            sqe->off = (req->offset < 0) ? (uint64_t)-1 : (uint64_t)req->offset;
+        }
+    }
+
+    sqarray[index] = index;
+    __atomic_store_n(sqtail, tail + 1, __ATOMIC_RELEASE);
+    ++inflight;
+    return true;
+}
+
+int AsyncIO::ring::enter(unsigned submit, unsigned wait)
+{
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    int result;
+
+    do {
+        // pass everything the kernel has not yet consumed...
+        if(submit)
+            submit = *sqtail - __atomic_load_n(sqhead, __ATOMIC_ACQUIRE);
+        result = (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+    } while(result < 0 && errno == EINTR);
+    return result;
+}
+
+// only the reaping thread consumes completions
+bool AsyncIO::ring::next(request **req, int *result)
+{
+    unsigned head = *cqhead;
+
+    if(head == __atomic_load_n(cqtail, __ATOMIC_ACQUIRE))
+        return false;
+
+    struct io_uring_cqe *cqe = &cqes[head & *cqmask];
+    *req = (request *)(uintptr_t)cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(cqhead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#endif
+
+AsyncIO::request::request()
+{
+    next = NULL;
+    fd = INVALID_HANDLE_VALUE;
+    data = NULL;
+    size = 0;
+    offset = 0;
+    op = 0;
+    count = 0;
+    error = 0;
+    busy = false;
+}
+
+AsyncIO::request::~request()
+{
+}
+
+void AsyncIO::request::completed(void)
+{
+}
+
+AsyncIO::AsyncIO(unsigned depth, unsigned count) :
+Conditional()
+{
+    if(!depth)
+        depth = 64;
+
+    if(!count)
+        count = Thread::cpus();
+
+    threads = NULL;
+    uring = NULL;
+    active = 0;
+    staged = last = NULL;
+    ready = tail = NULL;
+    working = NULL;
+    running = true;
+
+#ifdef  USE_URING
+    uring = new ring(depth);
+    if(uring->fd < 0) {
+        delete uring;
+        uring = NULL;
+    }
+#endif
+
+    // io_uring needs only a single thread to collect completions
+    if(uring)
+        count = 1;
+
+    workers = count;
+    threads = new worker *[count];
+    for(unsigned pos = 0; pos < count; ++pos) {
+        threads[pos] = new worker(this);
+        threads[pos]->start();
+    }
+}
+
+AsyncIO::~AsyncIO()
+{
+    wait();
+
+    lock();
+    running = false;
+#ifdef  USE_URING
+    if(uring && uring->push(NULL))
+        uring->enter(1, 0);
+#endif
+    Conditional::broadcast();
+    unlock();
+
+    for(unsigned pos = 0; pos < workers; ++pos)
+        delete threads[pos];
+
+    delete[] threads;
+    threads = NULL;
+
+#ifdef  USE_URING
+    if(uring) {
+        delete uring;
+        uring = NULL;
+    }
+#endif
+}
+
+bool AsyncIO::stage(request *req, unsigned op, fsys& fs, caddr_t data, size_t size, fsys::offset_t offset)
+{
+    // ring lengths are 32 bits and results are ints...
+    if(size > (size_t)INT_MAX)
+        return false;
+
+    lock();
+    if(req->busy || !running) {
+        unlock();
+        return false;
+    }
+
+    req->next = NULL;
+    req->fd = *fs;
+    req->data = data;
+    req->size = size;
+    req->offset = offset;
+    req->op = op;
+    req->count = 0;
+    req->error = 0;
+    req->busy = true;
+
+    if(last)
+        last->next = req;
+    else
+        staged = req;
+    last = req;
+    unlock();
+    return true;
+}
+
+bool AsyncIO::read(request *req, fsys& fs, void *data, size_t size, fsys::offset_t offset)
+{
+    return stage(req, AIO_READ, fs, (caddr_t)data, size, offset);
+}
+
+bool AsyncIO::write(request *req, fsys& fs, const void *data, size_t size, fsys::offset_t offset)
+{
+    return stage(req, AIO_WRITE, fs, (caddr_t)data, size, offset);
+}
+
+bool AsyncIO::sync(request *req, fsys& fs)
+{
+    return stage(req, AIO_SYNC, fs, NULL, 0, 0);
+}
+
+void AsyncIO::submit(void)
+{
+    lock();
+    if(staged) {
+        for(request *req = staged; req; req = req->next)
+            ++active;
+
+        if(tail)
+            tail->next = staged;
+        else
+            ready = staged;
+        tail = last;
+        staged = last = NULL;
+        dispatch();
+    }
+    unlock();
+}
+
+// called with the engine locked
+void AsyncIO::dispatch(void)
+{
+#ifdef  USE_URING
+    if(uring) {
+        unsigned count = 0;
+        request *req;
+
+        // the ring does not order current position i/o, so requests
+        // are held back like the worker pool does...
+        while(!uring->full() && (req = take()) != NULL) {
+            uring->push(req);
+            ++count;
+        }
+
+        // the whole batch is passed to the kernel in one call...
+        if(count)
+            uring->enter(count, 0);
+        return;
+    }
+#endif
+    Conditional::broadcast();
+}
+
+void AsyncIO::complete(request *req, ssize_t result, int error)
+{
+    req->count = result;
+    req->error = error;
+    req->completed();
+
+    lock();
+    // a worker request leaves the working list...
+    request **prior = &working;
+    while(*prior && *prior != req)
+        prior = &(*prior)->next;
+    if(*prior)
+        *prior = req->next;
+
+    req->busy = false;
+    --active;
+    Conditional::broadcast();
+    unlock();
+}
+
+void AsyncIO::reap(void)
+{
+#ifdef  USE_URING
+    request *req;
+    int result;
+
+    for(;;) {
+        uring->enter(0, 1);
+
+        while(uring->next(&req, &result)) {
+            lock();
+            --uring->inflight;
+            unlock();
+
+            if(!req)
+                continue;
+
+            if(result < 0)
+                complete(req, -1, -result);
+            else
+                complete(req, result, 0);
+        }
+
+        lock();
+        if(!running && !active) {
+            unlock();
+            return;
+        }
+        // submit requests left waiting for ring space...
+        dispatch();
+        unlock();
+    }
+#endif
+}
+
+// called with the engine locked; current position i/o and syncs on a
+// descriptor are serialized with the requests for it before them, for
+// both the worker pool and the ring
+AsyncIO::request *AsyncIO::take(void)
+{
+    request *req = ready, *prev = NULL, *prior;
+
+    while(req) {
+        bool ordered = (req->offset < 0 || req->op == AIO_SYNC);
+        bool blocked = false;
+
+        for(prior = working; !blocked && prior; prior = prior->next) {
+            if(prior->fd == req->fd && (ordered || prior->offset < 0 || prior->op == AIO_SYNC))
+                blocked = true;
+        }
+
+        for(prior = ready; !blocked && prior != req; prior = prior->next) {
+            if(prior->fd == req->fd && (ordered || prior->offset < 0 || prior->op == AIO_SYNC))
+                blocked = true;
+        }
+
+        if(!blocked)
+            break;
+
+        prev = req;
+        req = req->next;
+    }
+
+    if(!req)
+        return NULL;
+
+    if(prev)
+        prev->next = req->next;
+    else
+        ready = req->next;
+    if(tail == req)
+        tail = prev;
+
+    req->next = working;
+    working = req;
+    return req;
+}
+
+void AsyncIO::service(void)
+{
+    ssize_t result;
+    int error;
+
+    for(;;) {
+        lock();
+        request *req = take();
+        while(!req && (running || ready)) {
+            Conditional::wait();
+            req = take();
+        }
+
+        if(!req) {
+            unlock();
+            return;
+        }
+        unlock();
+
+        error = 0;
+#ifdef  _MSWINDOWS_
+        DWORD count = 0;
+        OVERLAPPED ov;
+        LPOVERLAPPED pov = NULL;
+
+        if(req->offset >= 0 && req->op != AIO_SYNC) {
+            memset(&ov, 0, sizeof(ov));
+            ov.Offset = (DWORD)(req->offset & 0xffffffff);
+            ov.OffsetHigh = (DWORD)((uint64_t)req->offset >> 32);
+            pov = &ov;
+        }
+
+        BOOL ok;
+        switch(req->op) {
+        case AIO_READ:
+            ok = ReadFile(req->fd, req->data, (DWORD)req->size, &count, pov);
+            break;
+        case AIO_WRITE:
+            ok = WriteFile(req->fd, req->data, (DWORD)req->size, &count, pov);
+            break;
+        default:
+            ok = FlushFileBuffers(req->fd);
+            break;
+        }
+        if(ok)
+            result = (ssize_t)count;
+        else {
+            result = -1;
+            error = EIO;
+        }
+#else
+        do {
+            switch(req->op) {
+            case AIO_READ:
+                if(req->offset < 0)
+                    result = ::read(req->fd, req->data, req->size);
+                else
+                    result = ::pread(req->fd, req->data, req->size, (off_t)req->offset);
+                break;
+            case AIO_WRITE:
+                if(req->offset < 0)
+                    result = ::write(req->fd, req->data, req->size);
+                else
+                    result = ::pwrite(req->fd, req->data, req->size, (off_t)req->offset);
+                break;
+            default:
+                result = ::fsync(req->fd);
+                break;
+            }
+        } while(result < 0 && errno == EINTR);
+
+        if(result < 0)
+            error = errno;
+#endif
+        complete(req, result, error);
+    }
+}
+
+ssize_t AsyncIO::wait(request *req)
+{
+    submit();
+
+    lock();
+    while(req->busy)
+        Conditional::wait();
+    unlock();
+
+    return req->count;
+}
+
+void AsyncIO::wait(void)
+{
+    submit();
+
+    lock();
+    while(active)
+        Conditional::wait();
+    unlock();
+}
+
+} // namespace ucommon
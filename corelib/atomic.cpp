@@ -99,6 +99,15 @@ void Atomic::counter::clear() volatile
     _InterlockedAnd(&value, 0);
 }
 
+bool Atomic::counter::compare_exchange(atomic_t& expected, atomic_t change) volatile
+{
+    atomic_t prior = InterlockedCompareExchange(&value, change, expected);
+    if(prior == expected)
+        return true;
+    expected = prior;
+    return false;
+}
+
 bool Atomic::spinlock::acquire() volatile
 {
     return !InterlockedBitTestAndSet(&value, 1);
@@ -136,6 +145,11 @@ void Atomic::counter::clear() volatile
     std::atomic_fetch_and_explicit((atomic_val)(&value), (atomic_t)0, std::memory_order_release);
 }
 
+bool Atomic::counter::compare_exchange(atomic_t& expected, atomic_t change) volatile
+{
+    return std::atomic_compare_exchange_strong_explicit((atomic_val)(&value), &expected, change, std::memory_order_seq_cst, std::memory_order_seq_cst);
+}
+
 atomic_t Atomic::counter::fetch_retain() volatile
 {
     return std::atomic_fetch_add_explicit((atomic_val)(&value), (atomic_t)1, std::memory_order_relaxed);
@@ -193,6 +207,11 @@ void Atomic::counter::clear() volatile
     __c11_atomic_fetch_and((atomic_val)(&value), (atomic_t)0, __ATOMIC_RELEASE);
 }
 
+bool Atomic::counter::compare_exchange(atomic_t& expected, atomic_t change) volatile
+{
+    return __c11_atomic_compare_exchange_strong((atomic_val)(&value), &expected, change, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
 atomic_t Atomic::counter::fetch_retain() volatile
 {
     return __c11_atomic_fetch_add((atomic_val)(&value), (atomic_t)1, __ATOMIC_RELAXED);
@@ -269,6 +288,11 @@ void Atomic::counter::clear() volatile
     __atomic_fetch_and(&value, (atomic_t)0, __ATOMIC_RELEASE);
 }
 
+bool Atomic::counter::compare_exchange(atomic_t& expected, atomic_t change) volatile
+{
+    return __atomic_compare_exchange_n(&value, &expected, change, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
 bool Atomic::spinlock::acquire(void) volatile
 {
     // if not locked by another already, then we acquired it...
@@ -325,6 +349,15 @@ void Atomic::counter::clear() volatile
     __sync_fetch_and_and(&value, (atomic_t)0);
 }
 
+bool Atomic::counter::compare_exchange(atomic_t& expected, atomic_t change) volatile
+{
+    atomic_t prior = __sync_val_compare_and_swap(&value, expected, change);
+    if(prior == expected)
+        return true;
+    expected = prior;
+    return false;
+}
+
 bool Atomic::spinlock::acquire(void) volatile
 {
     // if not locked by another already, then we acquired it...
@@ -367,6 +400,20 @@ void Atomic::counter::clear() volatile
     Mutex::release((void *)&value);
 }
 
+bool Atomic::counter::compare_exchange(atomic_t& expected, atomic_t change) volatile
+{
+    bool rtn = true;
+    Mutex::protect((void *)&value);
+    if(value == expected)
+        value = change;
+    else {
+        expected = value;
+        rtn = false;
+    }
+    Mutex::release((void *)&value);
+    return rtn;
+}
+
 atomic_t Atomic::counter::fetch_add(atomic_t change) volatile
 {
     atomic_t rval;
@@ -443,13 +443,13 @@ void ConditionalLock::modify(void)
 
     assert(context && sharing >= context->count);
 
-    sharing -= context->count;
+    // hold the context while waiting so another thread cannot reuse it
+    sharing -= context->count++;
     while(sharing) {
         ++pending;
         waitSignal();
         --pending;
     }
-    ++context->count;
 }
 
 void ConditionalLock::commit(void)
@@ -85,6 +85,18 @@
 #include <sys/event.h>
 #endif
 
+#ifdef  HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#if defined(__linux__) && !defined(_MSWINDOWS_)
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(SYS_getdents64)
+#define USE_GETDENTS
+#endif
+
 namespace ucommon {
 
 const fsys::offset_t fsys::end = (offset_t)(-1);
@@ -527,6 +539,7 @@ void fsys::open(const char *path, access_t access)
 #ifdef  FILE_FLAG_SEQUENTIAL_SCAN
         attr |= FILE_FLAG_SEQUENTIAL_SCAN;
 #endif
+    case MAPPED:
     case RDONLY:
         amode = GENERIC_READ;
         smode = FILE_SHARE_READ;
@@ -595,6 +608,7 @@ void fsys::open(const char *path, unsigned fmode, access_t access)
         error = ENOSYS;
         return;
 
+    case MAPPED:
     case RDONLY:
         amode = GENERIC_READ;
         cmode = OPEN_ALWAYS;
@@ -864,6 +878,7 @@ void fsys::open(const char *path, unsigned fmode, access_t access)
         error = ENOSYS;
         return;
 
+    case MAPPED:
     case RDONLY:
         flags = O_RDONLY | O_CREAT;
         break;
@@ -930,6 +945,7 @@ void fsys::open(const char *path, access_t access)
         flags = O_RDONLY | O_STREAMING;
         break;
 #endif
+    case MAPPED:
     case RDONLY:
         flags = O_RDONLY;
         break;
@@ -1371,41 +1387,191 @@ int dir::remove(const char *path)
     return 0;
 }
 
+#ifndef _MSWINDOWS_
+
+// copy a range of a file using the kernel where possible, falling back
+// to a buffered loop when offloading is not supported for the files.
+static int copy_range(int in, int out, off_t from, off_t to, char **buffer, size_t size)
+{
+    static bool offload = true;
+    ssize_t count;
+    size_t len;
+
+#ifdef  HAVE_COPY_FILE_RANGE
+    if(offload) {
+        loff_t ipos = from, opos = from;
+        while(ipos < to) {
+            len = (size_t)(to - ipos);
+            if(len > 0x40000000)
+                len = 0x40000000;
+            count = ::copy_file_range(in, &ipos, out, &opos, len, 0);
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count < 0 && ipos == from && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                if(errno == ENOSYS)
+                    offload = false;
+                break;
+            }
+            if(count < 0)
+                return errno;
+            if(!count)
+                return 0;
+        }
+        if(ipos >= to)
+            return 0;
+    }
+#endif
+
+#ifdef  HAVE_SYS_SENDFILE_H
+    off_t ipos = from;
+    if(lseek(out, from, SEEK_SET) == from) {
+        while(ipos < to) {
+            len = (size_t)(to - ipos);
+            if(len > 0x40000000)
+                len = 0x40000000;
+            count = ::sendfile(out, in, &ipos, len);
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count < 0 && ipos == from && (errno == ENOSYS || errno == EINVAL))
+                break;
+            if(count < 0)
+                return errno;
+            if(!count)
+                return 0;
+        }
+        if(ipos >= to)
+            return 0;
+    }
+#endif
+
+    if(!*buffer) {
+#ifdef  HAVE_POSIX_MEMALIGN
+        void *addr;
+        if(!posix_memalign(&addr, 4096, size))
+            *buffer = (char *)addr;
+#else
+        *buffer = (char *)malloc(size);
+#endif
+        if(!*buffer)
+            return ENOMEM;
+    }
+
+    while(from < to) {
+        len = size;
+        if((off_t)len > to - from)
+            len = (size_t)(to - from);
+        count = ::pread(in, *buffer, len, from);
+        if(count < 0 && errno == EINTR)
+            continue;
+        if(count < 0)
+            return errno;
+        if(!count)
+            return 0;
+        len = (size_t)count;
+        char *bp = *buffer;
+        while(len) {
+            count = ::pwrite(out, bp, len, from);
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count < 0)
+                return errno;
+            bp += count;
+            from += count;
+            len -= count;
+        }
+    }
+    return 0;
+}
+
+#endif
+
 int fsys::copy(const char *oldpath, const char *newpath, size_t size)
 {
     int result = 0;
-    char *buffer = new char[size];
     fsys src, dest;
-    ssize_t count = (ssize_t)size;
 
-    if(!buffer) {
-        result = ENOMEM;
-        goto end;
-    }
+    if(!size)
+        size = 1024l * 1024l;
 
     remove(newpath);
 
     src.open(oldpath, fsys::STREAM);
-    if(!is(src))
+    if(!is(src)) {
+        result = src.err();
         goto end;
+    }
 
     dest.open(newpath, GROUP_PUBLIC, fsys::STREAM);
-    if(!is(dest))
+    if(!is(dest)) {
+        result = dest.err();
         goto end;
+    }
+
+#ifndef _MSWINDOWS_
+    {
+        struct stat ino;
+        char *buffer = NULL;
+        off_t pos = 0, data, hole;
 
-    while(count > 0) {
-        count = src.read(buffer, size);
-        if(count < 0) {
-            result = src.err();
+        if(::fstat(*src, &ino)) {
+            result = errno;
             goto end;
         }
-        if(count > 0)
-            count = dest.write(buffer, size);
-        if(count < 0) {
-            result = dest.err();
+
+        // procfs and sysfs report regular files of zero size...
+        bool sparse = S_ISREG(ino.st_mode) && ino.st_size > 0;
+
+        // copy only the data regions of sparse files...
+        while(sparse && !result && pos < ino.st_size) {
+            data = pos;
+            hole = ino.st_size;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+            data = ::lseek(*src, pos, SEEK_DATA);
+            if(data < 0 && errno == ENXIO)
+                break;
+            if(data < 0)
+                data = pos;
+            else {
+                hole = ::lseek(*src, data, SEEK_HOLE);
+                if(hole < 0 || hole > ino.st_size)
+                    hole = ino.st_size;
+            }
+#endif
+            result = copy_range(*src, *dest, data, hole, &buffer, size);
+            pos = hole;
+        }
+
+        if(buffer)
+            free(buffer);
+
+        // extend trailing hole...
+        if(sparse) {
+            if(!result && ::ftruncate(*dest, ino.st_size))
+                result = errno;
             goto end;
         }
     }
+#endif
+    // pipes, devices, and procfs files have no usable size, read to eof...
+    {
+        char *buffer = new char[size];
+        ssize_t count = (ssize_t)size;
+
+        while(count > 0) {
+            count = src.read(buffer, size);
+            if(count < 0) {
+                result = src.err();
+                break;
+            }
+            if(count > 0)
+                count = dest.write(buffer, count);
+            if(count < 0) {
+                result = dest.err();
+                break;
+            }
+        }
+        delete[] buffer;
+    }
 
 end:
     if(is(src))
@@ -1414,9 +1580,6 @@ end:
     if(is(dest))
         dest.close();
 
-    if(buffer)
-        delete[] buffer;
-
     if(result != 0)
         remove(newpath);
 
@@ -1820,5 +1983,341 @@ stringref_t fsys::prefix(void)
 }
 
 #endif
- 
+
+// directory entries are read in batches of this size
+#define DIRWALK_BATCH   65536
+
+#ifdef  DT_UNKNOWN
+#define DIRENT_TYPE(d)  ((d)->d_type)
+#else
+#define DT_UNKNOWN      0
+#define DT_DIR          4
+#define DIRENT_TYPE(d)  DT_UNKNOWN
+#endif
+
+#ifdef  USE_GETDENTS
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
+struct dirwalk_job
+{
+    dirwalk_job *next, *prev;
+    unsigned level;
+    char path[1];
+};
+
+class __LOCAL DirWalker::lane
+{
+public:
+    Mutex lock;
+    dirwalk_job *head, *tail;
+
+    lane();
+
+    void push(dirwalk_job *job);
+    dirwalk_job *pop(void);
+    dirwalk_job *steal(void);
+};
+
+class __LOCAL DirWalker::worker : public JoinableThread
+{
+private:
+    DirWalker *walker;
+    unsigned id;
+
+public:
+    worker(DirWalker *dw, unsigned index);
+    ~worker();
+
+    void run(void) __OVERRIDE;
+};
+
+DirWalker::lane::lane()
+{
+    head = tail = NULL;
+}
+
+// the owning thread works depth first from the head...
+void DirWalker::lane::push(dirwalk_job *job)
+{
+    lock.lock();
+    job->prev = NULL;
+    job->next = head;
+    if(head)
+        head->prev = job;
+    else
+        tail = job;
+    head = job;
+    lock.unlock();
+}
+
+dirwalk_job *DirWalker::lane::pop(void)
+{
+    lock.lock();
+    dirwalk_job *job = head;
+    if(job) {
+        head = job->next;
+        if(head)
+            head->prev = NULL;
+        else
+            tail = NULL;
+    }
+    lock.unlock();
+    return job;
+}
+
+// ...while other threads steal the oldest, shallowest directories
+dirwalk_job *DirWalker::lane::steal(void)
+{
+    lock.lock();
+    dirwalk_job *job = tail;
+    if(job) {
+        tail = job->prev;
+        if(tail)
+            tail->next = NULL;
+        else
+            head = NULL;
+    }
+    lock.unlock();
+    return job;
+}
+
+DirWalker::worker::worker(DirWalker *dw, unsigned index) :
+JoinableThread()
+{
+    walker = dw;
+    id = index;
+}
+
+DirWalker::worker::~worker()
+{
+    join();
+}
+
+void DirWalker::worker::run(void)
+{
+    walker->service(id);
+}
+
+DirWalker::DirWalker(unsigned count, unsigned maxdepth) :
+Conditional()
+{
+    if(!count)
+        count = Thread::cpus();
+
+    lanes = NULL;
+    list = NULL;
+    workers = count;
+    depth = maxdepth;
+    pending = queued = idle = found = 0;
+}
+
+DirWalker::~DirWalker()
+{
+}
+
+bool DirWalker::visit(const char *path, bool directory)
+{
+    const char *name = strrchr(path, '/');
+
+    __UNUSED(directory);
+
+    if(name)
+        ++name;
+    else
+        name = path;
+
+    return *name != '.';
+}
+
+void DirWalker::accept(const char *path)
+{
+    lock();
+    ++found;
+    if(list)
+        list->add(path);
+    unlock();
+}
+
+void DirWalker::push(unsigned id, const char *path, unsigned level)
+{
+    size_t len = strlen(path);
+    dirwalk_job *job = (dirwalk_job *)::malloc(sizeof(dirwalk_job) + len);
+
+    if(!job)
+        __THROW_ALLOC();
+
+    job->level = level;
+    memcpy(job->path, path, len + 1);
+
+    // counted before it is visible, so a thief cannot finish it first
+    lock();
+    ++pending;
+    ++queued;
+    lanes[id].push(job);
+    if(idle)
+        Conditional::signal();
+    unlock();
+}
+
+void DirWalker::service(unsigned id)
+{
+    for(;;) {
+        dirwalk_job *job = lanes[id].pop();
+        for(unsigned pos = 1; !job && pos < workers; ++pos)
+            job = lanes[(id + pos) % workers].steal();
+
+        if(job) {
+            lock();
+            --queued;
+            unlock();
+
+            scan(id, job->path, job->level);
+            ::free(job);
+
+            lock();
+            if(!--pending)
+                Conditional::broadcast();
+            unlock();
+            continue;
+        }
+
+        lock();
+        while(pending && !queued) {
+            ++idle;
+            Conditional::wait();
+            --idle;
+        }
+        if(!pending) {
+            unlock();
+            return;
+        }
+        unlock();
+    }
+}
+
+// path holds the directory with room to append the entry name
+void DirWalker::entry(unsigned id, char *path, size_t len, const char *name, unsigned type, unsigned level)
+{
+    bool directory;
+
+    if(*name == '.' && (name[1] == '.' || !name[1]))
+        return;
+
+    if(strlen(name) > 256)
+        return;
+
+    String::set(path + len, 257, name);
+
+    // only stat when the directory does not report the type
+    if(type == DT_UNKNOWN) {
+#ifdef  _MSWINDOWS_
+        directory = fsys::is_dir(path);
+#else
+        struct stat ino;
+        if(lstat(path, &ino))
+            return;
+        directory = S_ISDIR(ino.st_mode);
+#endif
+    }
+    else
+        directory = (type == DT_DIR);
+
+    if(!visit(path, directory))
+        return;
+
+    if(!directory)
+        accept(path);
+    else if(!depth || level < depth)
+        push(id, path, level + 1);
+}
+
+void DirWalker::scan(unsigned id, const char *path, unsigned level)
+{
+    size_t len = strlen(path);
+    char *filepath = (char *)::malloc(len + 258);
+
+    if(!filepath)
+        __THROW_ALLOC();
+
+    memcpy(filepath, path, len);
+    if(!len || filepath[len - 1] != '/')
+        filepath[len++] = '/';
+
+#if defined(USE_GETDENTS)
+    int fd = ::open(path, O_RDONLY | O_DIRECTORY);
+    char *batch = (fd > -1) ? (char *)::malloc(DIRWALK_BATCH) : NULL;
+    long count, pos;
+
+    while(batch && (count = syscall(SYS_getdents64, fd, batch, DIRWALK_BATCH)) > 0) {
+        for(pos = 0; pos < count;) {
+            struct linux_dirent64 *dirent = (struct linux_dirent64 *)(batch + pos);
+            pos += dirent->d_reclen;
+            entry(id, filepath, len, dirent->d_name, dirent->d_type, level);
+        }
+    }
+
+    if(batch)
+        ::free(batch);
+    if(fd > -1)
+        ::close(fd);
+#elif defined(_MSWINDOWS_)
+    char filename[256];
+    dir_t dir(path);
+
+    while(is(dir) && dir.read(filename, sizeof(filename)) > 0)
+        entry(id, filepath, len, filename, DT_UNKNOWN, level);
+#else
+    DIR *ds = opendir(path);
+    struct dirent *dirent;
+
+    while(ds && (dirent = readdir(ds)) != NULL)
+        entry(id, filepath, len, dirent->d_name, DIRENT_TYPE(dirent), level);
+
+    if(ds)
+        closedir(ds);
+#endif
+    ::free(filepath);
+}
+
+unsigned DirWalker::walk(const char *path)
+{
+    if(!fsys::is_dir(path))
+        return 0;
+
+    found = pending = queued = idle = 0;
+    lanes = new lane[workers];
+    push(0, path, 0);
+
+    worker **threads = new worker *[workers];
+    for(unsigned pos = 0; pos < workers; ++pos) {
+        threads[pos] = new worker(this, pos);
+        threads[pos]->start();
+    }
+
+    for(unsigned pos = 0; pos < workers; ++pos)
+        delete threads[pos];
+
+    delete[] threads;
+    delete[] lanes;
+    lanes = NULL;
+    return found;
+}
+
+unsigned DirWalker::walk(const char *path, StringPager& files)
+{
+    list = &files;
+    unsigned count = walk(path);
+    list = NULL;
+    files.sort();
+    return count;
+}
+
 } // namespace ucommon
@@ -0,0 +1,147 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon-config.h>
+#include <ucommon/export.h>
+#include <ucommon/hash.h>
+#include <cstring>
+
+namespace ucommon {
+
+// default secret and seed of wyhash; the seed is a plain constant so that
+// tables filled during static construction already use it.
+static const uint64_t secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+static uint64_t keyseed = 0xa0761d6478bd642full;
+
+static inline void mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b)
+{
+    mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t r8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t r4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t r3(const uint8_t *p, size_t k)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+uint64_t Hash::get(const void *key, size_t size, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t a, b;
+
+    seed ^= wymix(seed ^ secret[0], secret[1]);
+    if(size <= 16) {
+        if(size >= 4) {
+            a = (r4(p) << 32) | r4(p + ((size >> 3) << 2));
+            b = (r4(p + size - 4) << 32) | r4(p + size - 4 - ((size >> 3) << 2));
+        }
+        else if(size > 0) {
+            a = r3(p, size);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else {
+        size_t remains = size;
+        if(remains > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+                see1 = wymix(r8(p + 16) ^ secret[2], r8(p + 24) ^ see1);
+                see2 = wymix(r8(p + 32) ^ secret[3], r8(p + 40) ^ see2);
+                p += 48;
+                remains -= 48;
+            } while(remains > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(remains > 16) {
+            seed = wymix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+            remains -= 16;
+            p += 16;
+        }
+        a = r8(p + remains - 16);
+        b = r8(p + remains - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    mum(&a, &b);
+    return wymix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+uint64_t Hash::get(const void *key, size_t size)
+{
+    return get(key, size, keyseed);
+}
+
+uint64_t Hash::get(const char *text)
+{
+    return get(text, strlen(text), keyseed);
+}
+
+uint64_t Hash::mix(uint64_t first, uint64_t second)
+{
+    return wymix(first ^ secret[0], second ^ secret[1]);
+}
+
+void Hash::seed(uint64_t value)
+{
+    keyseed = value;
+}
+
+uint64_t Hash::seed(void)
+{
+    return keyseed;
+}
+
+} // namespace ucommon
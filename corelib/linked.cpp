@@ -21,6 +21,7 @@
 #include <ucommon/linked.h>
 #include <ucommon/string.h>
 #include <ucommon/thread.h>
+#include <ucommon/hash.h>
 
 namespace ucommon {
 
@@ -240,12 +241,7 @@ unsigned NamedObject::keyindex(const char *id, unsigned max)
     assert(id != nullptr && *id != 0);
     assert(max > 1);
 
-    unsigned val = 0;
-
-    while(*id)
-        val = (val << 1) ^ (*(id++) & 0x1f);
-
-    return val % max;
+    return (unsigned)(Hash::get(id) % max);
 }
 
 int NamedObject::compare(const char *cid) const
@@ -622,6 +618,178 @@ void NamedTree::purge(void)
     clearId();
 }
 
+NamedIndex::NamedIndex(unsigned size)
+{
+    create(size);
+}
+
+NamedIndex::NamedIndex(NamedObject **hash, unsigned size)
+{
+    create(NamedObject::count(hash, size));
+    add(hash, size);
+}
+
+NamedIndex::NamedIndex(const NamedTree *tree)
+{
+    create(tree->getIndex()->count());
+    add(tree);
+}
+
+void NamedIndex::create(unsigned size)
+{
+    size_t paths = 8;
+    while(paths < (size_t)size * 2)
+        paths <<= 1;
+
+    slots = new slot_t[paths];
+    memset(slots, 0, sizeof(slot_t) * paths);
+    mask = paths - 1;
+    used = 0;
+}
+
+NamedIndex::~NamedIndex()
+{
+    delete[] slots;
+}
+
+void NamedIndex::grow(void)
+{
+    slot_t *prior = slots;
+    size_t paths = mask + 1;
+
+    slots = new slot_t[paths * 2];
+    memset(slots, 0, sizeof(slot_t) * paths * 2);
+    mask = paths * 2 - 1;
+
+    for(size_t pos = 0; pos < paths; ++pos) {
+        if(prior[pos].object)
+            insert(prior[pos].hash, prior[pos].object);
+    }
+    delete[] prior;
+}
+
+void NamedIndex::insert(size_t hash, NamedObject *object)
+{
+    size_t pos = hash & mask;
+
+    while(slots[pos].object)
+        pos = (pos + 1) & mask;
+
+    slots[pos].hash = hash;
+    slots[pos].object = object;
+}
+
+void NamedIndex::add(NamedObject **hash, unsigned size)
+{
+    assert(hash != nullptr);
+
+    NamedObject *node = NamedObject::skip(hash, nullptr, size);
+    while(node) {
+        add(node);
+        node = NamedObject::skip(hash, node, size);
+    }
+}
+
+void NamedIndex::add(const NamedTree *tree)
+{
+    assert(tree != nullptr);
+
+    // children of a copied node may not be named yet...
+    NamedTree *node = tree->getFirst();
+    while(node) {
+        if(node->getId())
+            add(static_cast<NamedObject *>(node));
+        node = static_cast<NamedTree *>(node->getNext());
+    }
+}
+
+NamedObject *NamedIndex::add(NamedObject *object)
+{
+    assert(object != nullptr && object->getId() != nullptr);
+
+    const char *id = object->getId();
+    size_t hash = (size_t)Hash::get(id);
+    size_t pos = hash & mask;
+
+    while(slots[pos].object) {
+        if(slots[pos].hash == hash && slots[pos].object->equal(id)) {
+            NamedObject *prior = slots[pos].object;
+            slots[pos].object = object;
+            return prior;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    // keep at most half full so probe runs stay short
+    if((size_t)(used + 1) * 2 > mask + 1) {
+        grow();
+        insert(hash, object);
+    }
+    else {
+        slots[pos].hash = hash;
+        slots[pos].object = object;
+    }
+    ++used;
+    return nullptr;
+}
+
+NamedObject *NamedIndex::find(const char *name) const
+{
+    assert(name != nullptr && *name != 0);
+
+    size_t hash = (size_t)Hash::get(name);
+    size_t pos = hash & mask;
+
+    while(slots[pos].object) {
+        if(slots[pos].hash == hash && slots[pos].object->equal(name))
+            return slots[pos].object;
+        pos = (pos + 1) & mask;
+    }
+    return nullptr;
+}
+
+NamedObject *NamedIndex::remove(const char *name)
+{
+    assert(name != nullptr && *name != 0);
+
+    size_t hash = (size_t)Hash::get(name);
+    size_t pos = hash & mask;
+
+    while(slots[pos].object) {
+        if(slots[pos].hash == hash && slots[pos].object->equal(name))
+            break;
+        pos = (pos + 1) & mask;
+    }
+
+    NamedObject *object = slots[pos].object;
+    if(!object)
+        return nullptr;
+
+    // shift later entries of the probe run back into the hole, so that
+    // no tombstones are needed and misses still stop at an empty slot.
+    size_t hole = pos;
+    for(;;) {
+        pos = (pos + 1) & mask;
+        if(!slots[pos].object)
+            break;
+        size_t home = slots[pos].hash & mask;
+        if(((pos - home) & mask) >= ((pos - hole) & mask)) {
+            slots[hole] = slots[pos];
+            hole = pos;
+        }
+    }
+    slots[hole].hash = 0;
+    slots[hole].object = nullptr;
+    --used;
+    return object;
+}
+
+void NamedIndex::clear(void)
+{
+    memset(slots, 0, sizeof(slot_t) * (mask + 1));
+    used = 0;
+}
+
 LinkedObject::LinkedObject()
 {
     Next = nullptr;
@@ -22,68 +22,200 @@
 #include <ucommon/thread.h>
 #include <ucommon/linked.h>
 #include <ucommon/mapref.h>
+#include <ucommon/hash.h>
 #include <cstdlib>
 
 namespace ucommon {
 
+// keys are spread over this many lock stripes in maps of at least
+// MAPREF_STRIPED paths, smaller maps use a single stripe
+#define MAPREF_STRIPES  16
+#define MAPREF_STRIPED  64
+
 MapRef::Index::Index() :
 LinkedObject()
 {
     key = value = NULL;
+    hash = 0;
 }
 
 MapRef::Index::Index(LinkedObject **origin) :
 LinkedObject(origin)
 {
     key = value = NULL;
+    hash = 0;
+}
+
+LinkedObject **MapRef::Map::Stripe::table(size_t paths)
+{
+    LinkedObject **list = (LinkedObject **)pool.alloc(sizeof(LinkedObject *) * paths);
+    memset(list, 0, sizeof(LinkedObject *) * paths);
+    return list;
+}
+
+MapRef::Map::Stripe::Stripe(size_t paths, size_t paging) :
+pool(paging)
+{
+    free = last = NULL;
+    count = alloc = split = 0;
+    level = 0;
+    base = paths;
+    memset(segments, 0, sizeof(segments));
+}
+
+// the first table of a stripe is only made on first insert
+LinkedObject *MapRef::Map::Stripe::head(size_t hash)
+{
+    if(!segments[0])
+        return NULL;
+
+    return *locate(hash);
+}
+
+LinkedObject **MapRef::Map::Stripe::bucket(size_t path)
+{
+    if(path < base)
+        return &segments[0][path];
+
+    // segment n > 0 holds buckets from base << (n - 1) up to base << n
+    size_t scaled = path / base;
+    unsigned seg = 1;
+    while(scaled >>= 1)
+        ++seg;
+
+    return &segments[seg][path - (base << (seg - 1))];
+}
+
+LinkedObject **MapRef::Map::Stripe::locate(size_t hash)
+{
+    size_t paths = base << level;
+    size_t path = hash % paths;
+    if(path < split)
+        path = hash % (paths << 1);
+
+    return bucket(path);
+}
+
+void MapRef::Map::Stripe::grow(void)
+{
+    size_t paths = base << level;
+    size_t target = paths + split;
+
+    if(level >= (sizeof(segments) / sizeof(LinkedObject **)) - 1)
+        return;
+
+    // first bucket of a new segment
+    if(target == paths && !segments[level + 1])
+        segments[level + 1] = table(paths);
+
+    LinkedObject **from = bucket(split);
+    LinkedObject **to = bucket(target);
+    Index *node = static_cast<Index *>(*from);
+    LinkedObject **keep = from, **move = to;
+
+    // split one bucket, keeping the order of its chain
+    *from = NULL;
+    while(node) {
+        Index *next = static_cast<Index *>(node->Next);
+        node->Next = NULL;
+        if((node->hash % (paths << 1)) == split) {
+            *keep = node;
+            keep = &node->Next;
+        }
+        else {
+            *move = node;
+            move = &node->Next;
+        }
+        node = next;
+    }
+
+    if(++split == paths) {
+        split = 0;
+        ++level;
+    }
+}
+
+void MapRef::Map::Stripe::purge(void)
+{
+    size_t path = 0, paths = buckets();
+    linked_pointer<Index> ip;
+
+    while(path < paths) {
+        ip = *bucket(path++);
+        while(ip) {
+            if(ip->key)
+                ip->key->release();
+            if(ip->value)
+                ip->value->release();
+            ip.next();
+        }
+    }
+    free = last = NULL;
+    pool.purge();
 }
 
 MapRef::Map::Map(void *addr, size_t indexes, size_t paging) :
-Counted(addr, indexes), pool(paging)
+Counted(addr, indexes >= MAPREF_STRIPED ? MAPREF_STRIPES : 1)
 {
     size_t index = 0;
-    LinkedObject **list = get();
-    free = last = NULL;
-    count = alloc = 0;
-    
-    while(index < indexes) {
-        list[index++] = NULL;
+    Stripe *list = get();
+    size_t paths = (indexes + size - 1) / size;
+
+    frozen = false;
+    if(!paths)
+        paths = 1;
+
+    while(index < size) {
+        new((caddr_t)&list[index++]) Stripe(paths, paging);
     }
 }
 
 MapRef::Index *MapRef::Map::create(size_t key)
 {
-    LinkedObject **list = get();
-    caddr_t p = (caddr_t)(free);
-    if(free)
-        free = free->getNext();
+    Stripe *sp = stripe(key);
+    size_t hash = key / size;
+    caddr_t p = (caddr_t)(sp->free);
+    if(!sp->segments[0])
+        sp->segments[0] = sp->table(sp->base);
+    if(sp->free)
+        sp->free = sp->free->getNext();
     else {
-        ++alloc;
-        p = (caddr_t)pool.alloc(sizeof(Index));
+        ++sp->alloc;
+        p = (caddr_t)sp->pool.alloc(sizeof(Index));
     }
-    ++count;
-    return new(p) Index(&list[key % size]);
+    ++sp->count;
+    Index *ip = new(p) Index(sp->locate(hash));
+    ip->hash = hash;
+
+    // keep the average chain length near one, a bucket at a time
+    if(sp->count > sp->buckets())
+        sp->grow();
+
+    return ip;
 }
 
 MapRef::Index *MapRef::Map::append()
 {
-    LinkedObject **list = get();
-    caddr_t p = (caddr_t)(free);
-    if(free)
-        free = free->getNext();
+    Stripe *sp = get();
+    if(!sp->segments[0])
+        sp->segments[0] = sp->table(sp->base);
+    LinkedObject **list = sp->segments[0];
+    caddr_t p = (caddr_t)(sp->free);
+    if(sp->free)
+        sp->free = sp->free->getNext();
     else {
-        ++alloc;
-        p = (caddr_t)pool.alloc(sizeof(Index));
+        ++sp->alloc;
+        p = (caddr_t)sp->pool.alloc(sizeof(Index));
     }
-    ++count;
+    ++sp->count;
     Index *ip = new(p) Index();
-    if(last) {
-        Index *lp = static_cast<Index *>(last);
+    if(sp->last) {
+        Index *lp = static_cast<Index *>(sp->last);
         lp->Next = ip;
     }
     else
         list[0] = ip;
-    last = ip;
+    sp->last = ip;
     ip->Next = NULL;
     return ip;
 }       
@@ -99,81 +231,135 @@ void MapRef::Map::remove(Index *index, size_t path)
     if(index->value)
         index->value->release();
 
-    LinkedObject **root = get();
-    root = &root[path % size];
+    Stripe *sp = stripe(path);
+    LinkedObject **root = sp->locate(index->hash);
 
-    --count;
-    if(last && index == last) {
-        last = *(root);
-        if(last == index)
-            last = NULL;
+    --sp->count;
+    if(sp->last && index == sp->last) {
+        sp->last = *(root);
+        if(sp->last == index)
+            sp->last = NULL;
         else {
-            while(last && last->getNext() != index) {
-                last = last->getNext();
+            while(sp->last && sp->last->getNext() != index) {
+                sp->last = sp->last->getNext();
             }
         }
     }
     index->delist(root); 
-    index->enlist(&free);
+    index->enlist(&sp->free);
 }
 
 LinkedObject *MapRef::Map::access(size_t key)
 {
-    lock.access();
-	return (get())[key % size];
+    Stripe *sp = stripe(key);
+    sp->lock.access();
+	return sp->head(key / size);
 }
 
 LinkedObject *MapRef::Map::modify(size_t key)
 {
-    lock.modify();
-    return (get())[key % size];
+    Stripe *sp = stripe(key);
+    sp->lock.modify();
+    return sp->head(key / size);
+}
+
+void MapRef::Map::commit(size_t key)
+{
+    stripe(key)->lock.commit();
+}
+
+void MapRef::Map::unlock(size_t key)
+{
+    stripe(key)->lock.release();
+}
+
+void MapRef::Map::enter(void)
+{
+    size_t index = 0;
+    Stripe *list = get();
+
+    if(frozen)
+        return;
+
+    // always in stripe order so walkers cannot deadlock
+    while(index < size)
+        list[index++].lock.access();
+
+    // published while we waited, so no longer needs locks
+    if(frozen) {
+        while(index)
+            list[--index].lock.release();
+    }
+}
+
+void MapRef::Map::leave(void)
+{
+    size_t index = size;
+    Stripe *list = get();
+
+    if(frozen)
+        return;
+
+    while(index)
+        list[--index].lock.release();
+}
+
+void MapRef::Map::freeze(void)
+{
+    size_t index = 0;
+    Stripe *list = get();
+
+    if(frozen)
+        return;
+
+    while(index < size)
+        list[index++].lock.modify();
+
+    frozen = true;
+
+    while(index)
+        list[--index].lock.commit();
 }
 
 void MapRef::Map::dealloc()
 {
     size_t index = 0;
-    LinkedObject **list = get();
-    linked_pointer<Index> ip;
+    Stripe *list = get();
 
     if(!size)
         return;
 
     while(index < size) {
-		ip = list[index];
-		while(ip) {
-			if(ip->key)
-				ip->key->release();
-			if(ip->value)
-				ip->value->release();
-			ip.next();
-		}
-		++index;
+        list[index].purge();
+        list[index++].~Stripe();
 	}	
     size = 0;
-	free = last = NULL;
-	pool.purge();
     Counted::dealloc();
 }
 
 MapRef::Instance::Instance(Map *vmap)
 {
-    if(!vmap)
+    map = vmap;
+    index = NULL;
+    stripe = path = 0;
+    if(!map)
         return;
 
-    map = vmap;
     map->retain();
-    map->lock.access();
+    map->enter();
     rewind();
 }
 
 MapRef::Instance::Instance(MapRef& from)
 {
     map = static_cast<Map*>(from.ref);
+    index = NULL;
+    stripe = path = 0;
     if(!map)
         return;
 
     map->retain();
-    map->lock.access();
+    map->enter();
     rewind();
 }
 
@@ -181,19 +367,20 @@ MapRef::Instance::Instance()
 {
     map = NULL;
     index = NULL;
-    path = 0;
+    stripe = path = 0;
 }
 
 MapRef::Instance::Instance(const Instance& copy)
 {
     map = copy.map;
     index = copy.index;
+    stripe = copy.stripe;
     path = copy.path;
     if(!map)
         return;
 
     map->retain();
-    map->lock.access();
+    map->enter();
 }
 
 MapRef::Instance::~Instance()
@@ -206,11 +393,11 @@ void MapRef::Instance::drop()
     if(!map)
         return;
 
-    map->lock.release();
+    map->leave();
     map->release();
     map = NULL;
     index = NULL;
-    path = 0;
+    stripe = path = 0;
 }
 
 void MapRef::Instance::assign(const Instance& copy)
@@ -218,12 +405,13 @@ void MapRef::Instance::assign(const Instance& copy)
     drop();
     map = copy.map;
     index = copy.index;
+    stripe = copy.stripe;
     path = copy.path;
     if(!map)
         return;
 
     map->retain();
-    map->lock.access();
+    map->enter();
 }
 
 void MapRef::Instance::assign(MapRef& from)
@@ -234,7 +422,7 @@ void MapRef::Instance::assign(MapRef& from)
         return;
 
     map->retain();
-    map->lock.access();
+    map->enter();
     rewind();
 }
 
@@ -243,8 +431,8 @@ void MapRef::Instance::rewind()
     if(!map)
         return;
 
-    path = 0;
-    index = (map->get())[0];
+    stripe = path = 0;
+    index = map->get()->head(0);
     if(!index)
         next();
 }
@@ -254,10 +442,10 @@ bool MapRef::Instance::top()
     if(!map)
         return false;
 
-    if(path > 0)
+    if(stripe > 0 || path > 0)
         return false;
 
-    if(index != (map->get())[0])
+    if(index != map->get()->head(0))
         return false;
 
     return true;
@@ -284,7 +472,7 @@ bool MapRef::Instance::eol()
     if(!map)
         return false;
 
-    if(path < map->size)
+    if(stripe < map->size)
         return false;
 
     return true;
@@ -301,10 +489,15 @@ bool MapRef::Instance::next()
     if(index)
         return true;
 
-    while(++path < map->size) {
-        index = (map->get())[path];
-        if(index)
-            return true;
+    while(stripe < map->size) {
+        Map::Stripe *sp = map->get() + stripe;
+        while(++path < sp->buckets()) {
+            index = *(sp->bucket(path));
+            if(index)
+                return true;
+        }
+        ++stripe;
+        path = (size_t)-1;
     }
     return false;
 }
@@ -319,6 +512,12 @@ TypeRef(copy)
 {
 }
 
+MapRef::MapRef(const typeref_epoch& global) :
+TypeRef()
+{
+    TypeRef::assign(global);
+}
+
 MapRef::MapRef(size_t indexes, size_t paging) :
 TypeRef(create(indexes, paging))
 {
@@ -330,7 +529,11 @@ size_t MapRef::used()
 	if(!m)
         return 0;
 
-    return m->alloc;
+    size_t index = 0, total = 0;
+    while(index < m->size)
+        total += m->get()[index++].alloc;
+
+    return total;
 }
 
 size_t MapRef::count()
@@ -339,7 +542,11 @@ size_t MapRef::count()
 	if(!m)
         return 0;
 
-    return m->count;
+    size_t index = 0, total = 0;
+    while(index < m->size)
+        total += m->get()[index++].count;
+
+    return total;
 }
 
 void MapRef::remove(Index *ind, size_t path)
@@ -356,7 +563,8 @@ MapRef::Map *MapRef::create(size_t indexes, size_t paging)
     if(!indexes)
         return NULL;
 
-    size_t s = sizeof(Map) + (indexes * sizeof(Index *));
+    size_t stripes = (indexes >= MAPREF_STRIPED) ? MAPREF_STRIPES : 1;
+    size_t s = sizeof(Map) + (stripes * sizeof(Map::Stripe));
     caddr_t p = auto_release.allocate(s);
     return new(mem(p)) Map(p, indexes, paging);
 }
@@ -375,21 +583,22 @@ void MapRef::update(Index *ind, TypeRef& value)
 
 void MapRef::append(TypeRef& value)
 {
+    writable();
     Map *m = polydynamic_cast<Map *>(ref);
 	if(!m || !m->size)
 		return;
 
-    m->lock.modify();
+    m->modify(0);
     Index *ind = m->append();
     if(!ind) {
-        m->lock.commit();
+        m->commit(0);
         return;
     }
     ind->key = NULL;
     ind->value = value.ref;
     if(ind->value)
         ind->value->retain();
-    m->lock.commit();
+    m->commit(0);
 }
 
 void MapRef::add(size_t keypath, TypeRef& key, TypeRef& value)
@@ -417,14 +626,25 @@ linked_pointer<MapRef::Index> MapRef::access(size_t key)
 	if(!m || !m->size)
 		return ip;
 
-    m->retain();
-    ip = m->access(key);
+    if(!m->frozen) {
+        m->retain();
+        ip = m->access(key);
+        if(!m->frozen)
+            return ip;
+
+        // published while we waited, so no longer needs locks
+        m->unlock(key);
+        m->release();
+    }
+
+    ip = m->stripe(key)->head(key / m->size);
 	return ip;
 }
 
 linked_pointer<MapRef::Index> MapRef::modify(size_t key)
 {
     linked_pointer<Index> ip;
+    writable();
 	Map *m = polydynamic_cast<Map *>(ref);
 	if(!m || !m->size)
 		return ip;
@@ -434,32 +654,86 @@ linked_pointer<MapRef::Index> MapRef::modify(size_t key)
 	return ip;
 }
 
-void MapRef::commit()
+void MapRef::commit(size_t key)
 {
     Map *m = polydynamic_cast<Map *>(ref);
 	if(!m || !m->size)
 		return;
 
-    m->lock.commit();
+    m->commit(key);
     m->release();
 }
 
-void MapRef::release()
+void MapRef::release(size_t key)
 {
     Map *m = polydynamic_cast<Map *>(ref);
 	if(!m || !m->size)
 		return;
 
-    m->lock.release();
+    if(m->frozen)
+        return;
+
+    m->unlock(key);
     m->release();
 }
 
+void MapRef::writable(void)
+{
+    Map *m = polydynamic_cast<Map *>(ref);
+    if(m && m->frozen)
+        resize(m->get()->base * m->size);
+}
+
+void MapRef::resize(size_t paths)
+{
+    Map *current = polydynamic_cast<Map *>(ref);
+    if(!current)
+        return;
+
+    Map *m = create(paths, current->get()->pool.size());
+    if(!m)
+        return;
+
+    current->enter();
+    for(size_t stripe = 0; stripe < current->size; ++stripe) {
+        Map::Stripe *sp = current->get() + stripe;
+        for(size_t path = 0; path < sp->buckets(); ++path) {
+            linked_pointer<Index> ip = *(sp->bucket(path));
+            while(is(ip)) {
+                Index *ind;
+                // appended entries have no key, and keep their order
+                if(ip->key)
+                    ind = m->create(ip->hash * current->size + stripe);
+                else
+                    ind = m->append();
+                ind->key = ip->key;
+                ind->value = ip->value;
+                if(ind->key)
+                    ind->key->retain();
+                if(ind->value)
+                    ind->value->retain();
+                ip.next();
+            }
+        }
+    }
+    current->leave();
+    TypeRef::set(m);
+}
+
+void MapRef::publish(typeref_epoch& target)
+{
+    Map *m = polydynamic_cast<Map *>(ref);
+    if(m)
+        m->freeze();
+    target.set(*this);
+}
+
 size_t MapRef::index(size_t& key, const uint8_t *addr, size_t len)
 {
-	while(len-- && addr) {
-		key ^= (key << 3) ^ *addr;
-		++addr;
-	}
+    if(!addr)
+        len = 0;
+
+    key = (size_t)Hash::get(addr, len, Hash::seed() + key);
 	return key;
 }
 
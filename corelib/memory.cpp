@@ -63,9 +63,15 @@ void memalloc::assign(memalloc& source)
     align = source.align;
     count = source.count;
     page = source.page;
+    current = source.current;
+    large = source.large;
     limit = source.limit;
+    for(unsigned pos = 0; pos < partials; ++pos) {
+        partial[pos] = source.partial[pos];
+        source.partial[pos] = NULL;
+    }
     source.count = 0;
-    source.page = NULL;
+    source.page = source.current = source.large = NULL;
 }
 
 memalloc::memalloc(size_t ps)
@@ -104,14 +110,18 @@ memalloc::memalloc(size_t ps)
     pagesize = ps;
     count = 0;
     limit = 0;
-    page = NULL;
+    page = current = large = NULL;
+    for(unsigned pos = 0; pos < partials; ++pos)
+        partial[pos] = NULL;
 }
 
 memalloc::memalloc(const memalloc& copy)
 {
     count = 0;
     limit = 0;
-    page = NULL;
+    page = current = large = NULL;
+    for(unsigned pos = 0; pos < partials; ++pos)
+        partial[pos] = NULL;
     pagesize = copy.pagesize;
     align = copy.align;
 }
@@ -123,14 +133,9 @@ memalloc::~memalloc()
 
 unsigned memalloc::utilization(void) const
 {
-    unsigned long used = 0, alloc = 0;
-    page_t *mp = page;
+    unsigned long used, alloc;
 
-    while(mp) {
-        alloc += (unsigned long)pagesize;
-        used += mp->used;
-        mp = mp->next;
-    }
+    usage(used, alloc);
 
     if(!used)
         return 0;
@@ -140,6 +145,27 @@ unsigned memalloc::utilization(void) const
     return used;
 }
 
+void memalloc::usage(unsigned long& used, unsigned long& alloc) const
+{
+    page_t *mp = page;
+
+    used = alloc = 0;
+
+    while(mp) {
+        alloc += (unsigned long)pagesize;
+        used += mp->used;
+        mp = mp->next;
+    }
+
+    // oversize blocks are always fully used
+    mp = large;
+    while(mp) {
+        alloc += mp->used;
+        used += mp->used;
+        mp = mp->next;
+    }
+}
+
 void memalloc::purge(void)
 {
     page_t *next;
@@ -155,6 +181,14 @@ void memalloc::purge(void)
 #endif
         page = next;
     }
+    while(large) {
+        next = large->next;
+        free(large);
+        large = next;
+    }
+    current = NULL;
+    for(unsigned pos = 0; pos < partials; ++pos)
+        partial[pos] = NULL;
     count = 0;
 }
 
@@ -196,37 +230,263 @@ memalloc::page_t *memalloc::pager(void)
     if((size_t)(npage) % sizeof(void *))
         npage->used += sizeof(void *) - ((size_t)(npage) % sizeof(void
 *));
+
+    // keep the retired page if it has more room than a partial page we hold
+    if(current) {
+        unsigned slot = 0;
+        size_t least = pagesize;
+        for(unsigned pos = 0; pos < partials; ++pos) {
+            size_t avail = 0;
+            if(partial[pos])
+                avail = pagesize - partial[pos]->used;
+            if(avail < least) {
+                least = avail;
+                slot = pos;
+            }
+        }
+        if(pagesize - current->used > least)
+            partial[slot] = current;
+    }
+
+    current = npage;
     return npage;
 }
 
-void *memalloc::_alloc(size_t size)
+void *memalloc::oversize(size_t size)
 {
-    assert(size > 0);
+    page_t *npage = NULL;
+    size_t head = sizeof(page_t);
+#ifdef  HAVE_POSIX_MEMALIGN
+    void *addr;
+#endif
 
-    caddr_t mem;
-    page_t *p = page;
+    if(limit && count >= limit) {
+        __THROW_RUNTIME("pager exhausted");
+        return NULL;
+    }
+
+    // pad the header so the block itself keeps the pager alignment
+    if(align && head % align)
+        head += align - (head % align);
+
+#if defined(HAVE_POSIX_MEMALIGN)
+    if(align && !posix_memalign(&addr, align, head + size))
+        npage = (page_t *)addr;
+    else
+        npage = (page_t *)malloc(head + size);
+#elif defined(HAVE_ALIGNED_ALLOC)
+    if(align)
+        npage = (page_t *)aligned_alloc(align, ((head + size + align - 1) / align) * align);
+    else
+        npage = (page_t *)malloc(head + size);
+#else
+    npage = (page_t *)malloc(head + size);
+#endif
 
-    if(size > (pagesize - sizeof(page_t))) {
-        __THROW_SIZE("Larger than pagesize");
+    if(!npage) {
+        __THROW_ALLOC();
         return NULL;
     }
 
+    ++count;
+    npage->used = head + size;
+    npage->next = large;
+    large = npage;
+    return ((caddr_t)(npage)) + head;
+}
+
+void *memalloc::_alloc(size_t size)
+{
+    assert(size > 0);
+
+    caddr_t mem;
+    page_t *p = current;
+
     while(size % sizeof(void *))
         ++size;
 
-    while(p) {
-        if(size <= pagesize - p->used)
-            break;
-        p = p->next;
+    if(size > (pagesize - sizeof(page_t) - sizeof(void *)))
+        return oversize(size);
+
+    if(!p || size > pagesize - p->used) {
+        p = NULL;
+        for(unsigned pos = 0; pos < partials; ++pos) {
+            if(partial[pos] && size <= pagesize - partial[pos]->used) {
+                p = partial[pos];
+                break;
+            }
+        }
     }
+
     if(!p)
         p = pager();
 
     mem = ((caddr_t)(p)) + p->used;
-    p->used += (unsigned)size;
+    p->used += size;
     return mem;
 }
 
+// a per-thread slab of a shared pager.  Slabs are kept on a list so they
+// can be reclaimed with the pager, and are removed when the thread that
+// uses it exits.
+class __LOCAL pager_arena : public LinkedObject
+{
+public:
+    pthread_mutex_t *lock;
+    LinkedObject **root;
+    caddr_t cursor;
+    size_t avail;
+    atomic_t generation;
+
+    pager_arena(LinkedObject **list, pthread_mutex_t *mutex) :
+    LinkedObject(list) {
+        lock = mutex;
+        root = list;
+        cursor = NULL;
+        avail = 0;
+        generation = 0;
+    }
+};
+
+extern "C" {
+    static void arena_exit(void *obj)
+    {
+        pager_arena *arena = static_cast<pager_arena *>(obj);
+
+        pthread_mutex_lock(arena->lock);
+        arena->delist(arena->root);
+        pthread_mutex_unlock(arena->lock);
+        delete arena;
+    }
+}
+
+memarenas::memarenas() :
+generation(1)
+{
+    pthread_mutex_init(&mutex, NULL);
+    arenas = NULL;
+    slab = 0;
+}
+
+memarenas::~memarenas()
+{
+    if(slab) {
+#ifdef  _MSTHREADS_
+        TlsFree(key);
+#else
+        pthread_key_delete(key);
+#endif
+        if(arenas)
+            LinkedObject::purge(arenas);
+    }
+    pthread_mutex_destroy(&mutex);
+}
+
+bool memarenas::enable(size_t size)
+{
+    if(slab)
+        return true;
+
+    size -= size % sizeof(void *);
+    if(size < sizeof(void *))
+        return false;
+
+#ifdef  _MSTHREADS_
+    key = TlsAlloc();
+#else
+    if(pthread_key_create(&key, &arena_exit))
+        return false;
+#endif
+    slab = size;
+    return true;
+}
+
+void *memarenas::get(size_t size)
+{
+#ifdef  _MSTHREADS_
+    pager_arena *arena = (pager_arena *)TlsGetValue(key);
+#else
+    pager_arena *arena = (pager_arena *)pthread_getspecific(key);
+#endif
+    caddr_t mem;
+
+    // acquire, so a purge that invalidated our slab is seen before we
+    // carve from it.
+    if(!arena || arena->generation != generation.get() || size > arena->avail)
+        return NULL;
+
+    mem = arena->cursor;
+    arena->cursor += size;
+    arena->avail -= size;
+    return mem;
+}
+
+void *memarenas::refill(void *memory, size_t size)
+{
+#ifdef  _MSTHREADS_
+    pager_arena *arena = (pager_arena *)TlsGetValue(key);
+#else
+    pager_arena *arena = (pager_arena *)pthread_getspecific(key);
+#endif
+    caddr_t mem = (caddr_t)memory;
+
+    if(!arena) {
+        pthread_mutex_lock(&mutex);
+        arena = new pager_arena(&arenas, &mutex);
+        pthread_mutex_unlock(&mutex);
+#ifdef  _MSTHREADS_
+        TlsSetValue(key, arena);
+#else
+        pthread_setspecific(key, arena);
+#endif
+    }
+
+    // the old slab remainder is simply abandoned to the pager
+    arena->generation = generation.get();
+    if(!mem) {
+        arena->cursor = NULL;
+        arena->avail = 0;
+        return NULL;
+    }
+
+    arena->cursor = mem + size;
+    arena->avail = slab - size;
+    return mem;
+}
+
+void memarenas::invalidate(void)
+{
+    ++generation;
+}
+
+unsigned memarenas::utilization(unsigned long used, unsigned long alloc) const
+{
+    unsigned long idle = 0;
+    atomic_t current = generation.get();
+
+    pthread_mutex_lock(&mutex);
+    linked_pointer<pager_arena> arena = arenas;
+    while(is(arena)) {
+        if(arena->generation == current)
+            idle += (unsigned long)arena->avail;
+        arena.next();
+    }
+    pthread_mutex_unlock(&mutex);
+
+    // unused remainder of thread slabs is not really in use
+    if(idle < used)
+        used -= idle;
+    else
+        used = 0;
+
+    if(!used)
+        return 0;
+
+    alloc /= 100;
+    used /= alloc;
+    return used;
+}
+
 mempager::mempager(size_t ps) :
 memalloc(ps)
 {
@@ -234,9 +494,11 @@ memalloc(ps)
 }
 
 mempager::mempager(const mempager& copy) :
-memalloc(copy) 
+memalloc(copy)
 {
     pthread_mutex_init(&mutex, NULL);
+    if(copy.arenas.size())
+        caching(copy.arenas.size());
 }
 
 mempager::~mempager()
@@ -245,6 +507,14 @@ mempager::~mempager()
     pthread_mutex_destroy(&mutex);
 }
 
+void mempager::caching(size_t size)
+{
+    if(!size)
+        size = (memalloc::size() - sizeof(void *) * 4) / 4;
+
+    arenas.enable(size);
+}
+
 void mempager::_lock(void)
 {
     pthread_mutex_lock(&mutex);
@@ -257,17 +527,20 @@ void mempager::_unlock(void)
 
 unsigned mempager::utilization(void)
 {
-    unsigned long used;
+    unsigned long used, alloc;
+    unsigned result;
 
     pthread_mutex_lock(&mutex);
-    used = memalloc::utilization();
+    memalloc::usage(used, alloc);
+    result = arenas.utilization(used, alloc);
     pthread_mutex_unlock(&mutex);
-    return used;
+    return result;
 }
 
 void mempager::purge(void)
 {
     pthread_mutex_lock(&mutex);
+    arenas.invalidate();
     memalloc::purge();
     pthread_mutex_unlock(&mutex);
 }
@@ -281,6 +554,21 @@ void *mempager::_alloc(size_t size)
     assert(size > 0);
 
     void *mem;
+
+    if(arenas.size()) {
+        while(size % sizeof(void *))
+            ++size;
+        if(arenas.fits(size)) {
+            mem = arenas.get(size);
+            if(mem)
+                return mem;
+            pthread_mutex_lock(&mutex);
+            mem = arenas.refill(memalloc::_alloc(arenas.size()), size);
+            pthread_mutex_unlock(&mutex);
+            return mem;
+        }
+    }
+
     pthread_mutex_lock(&mutex);
     mem = memalloc::_alloc(size);
     pthread_mutex_unlock(&mutex);
@@ -291,6 +579,8 @@ void mempager::assign(mempager& source)
 {
     pthread_mutex_lock(&source.mutex);
     pthread_mutex_lock(&mutex);
+    source.arenas.invalidate();
+    arenas.invalidate();
     memalloc::assign(source);
     pthread_mutex_unlock(&mutex);
     pthread_mutex_unlock(&source.mutex);
@@ -0,0 +1,617 @@
+// Copyright (C) 2006-2014 David Sugar, Tycho Softworks.
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon-config.h>
+#include <ucommon/export.h>
+#include <ucommon/socket.h>
+#include <ucommon/thread.h>
+#include <ucommon/reactor.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#elif defined(HAVE_SYS_POLL_H)
+#include <sys/poll.h>
+#endif
+
+#if defined(_MSWINDOWS_)
+#define poll(fds, count, timeout)   WSAPoll(fds, count, timeout)
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifndef EPOLLRDHUP
+#define EPOLLRDHUP 0
+#endif
+
+namespace ucommon {
+
+// default size of per client buffers
+#define REACTOR_BUFSIZE     4096
+
+// events collected per epoll wakeup
+#define REACTOR_EVENTS      64
+
+class __LOCAL TCPReactor::loop : public JoinableThread
+{
+private:
+    TCPReactor *reactor;
+    bool dispatcher;
+
+public:
+    loop(TCPReactor *server, bool events);
+
+    void run(void) __OVERRIDE;
+};
+
+TCPReactor::loop::loop(TCPReactor *server, bool events) :
+JoinableThread()
+{
+    reactor = server;
+    dispatcher = events;
+}
+
+void TCPReactor::loop::run(void)
+{
+    if(dispatcher)
+        reactor->dispatch();
+    else
+        reactor->service();
+}
+
+static bool blocked(int err)
+{
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+    if(err == EWOULDBLOCK)
+        return true;
+#endif
+    return err == EAGAIN;
+}
+
+static void hangup(socket_t so)
+{
+#ifdef  _MSWINDOWS_
+    ::shutdown(so, SD_BOTH);
+    ::closesocket(so);
+#else
+    ::shutdown(so, SHUT_RDWR);
+    ::close(so);
+#endif
+}
+
+TCPReactor::connection::connection(socket_t socket, size_t size) :
+DLinkedObject()
+{
+    if(!size)
+        size = REACTOR_BUFSIZE;
+
+    queued = NULL;
+    so = socket;
+    bufsize = size;
+    ihead = itail = ohead = otail = 0;
+    busy = closing = eof = false;
+    ioerr = 0;
+    memset(&peer, 0, sizeof(peer));
+    ibuf = (caddr_t)malloc(size * 2);
+    obuf = ibuf + size;
+    if(!ibuf)
+        __THROW_ALLOC();
+}
+
+TCPReactor::connection::~connection()
+{
+    if(ibuf) {
+        ::free(ibuf);
+        ibuf = obuf = NULL;
+    }
+}
+
+bool TCPReactor::connection::fill(void)
+{
+    if(ihead) {
+        memmove(ibuf, ibuf + ihead, itail - ihead);
+        itail -= ihead;
+        ihead = 0;
+    }
+
+    while(itail < bufsize) {
+        ssize_t result = ::recv(so, ibuf + itail, (socksize_t)(bufsize - itail), 0);
+        if(result > 0) {
+            itail += (size_t)result;
+            continue;
+        }
+        if(!result) {
+            eof = true;
+            return false;
+        }
+        int err = Socket::error();
+        if(err == EINTR)
+            continue;
+        if(!blocked(err))
+            ioerr = err;
+        return false;
+    }
+    // buffer filled before socket was drained...
+    return true;
+}
+
+bool TCPReactor::connection::flush(void)
+{
+    while(ohead < otail) {
+        ssize_t result = ::send(so, obuf + ohead, (socksize_t)(otail - ohead), MSG_NOSIGNAL);
+        if(result > 0) {
+            ohead += (size_t)result;
+            continue;
+        }
+        int err = Socket::error();
+        if(result < 0 && err == EINTR)
+            continue;
+        if(result < 0 && blocked(err))
+            return true;
+        ioerr = err ? err : EIO;
+        return false;
+    }
+    ohead = otail = 0;
+    return true;
+}
+
+void TCPReactor::connection::consume(size_t size)
+{
+    if(size > itail - ihead)
+        size = itail - ihead;
+
+    ihead += size;
+    if(ihead == itail)
+        ihead = itail = 0;
+}
+
+size_t TCPReactor::connection::readline(char *data, size_t max)
+{
+    assert(data != NULL);
+    assert(max > 0);
+
+    const char *cp = (const char *)memchr(ibuf + ihead, '\n', itail - ihead);
+    if(!cp) {
+        *data = 0;
+        return 0;
+    }
+
+    size_t used = (size_t)(cp - (ibuf + ihead)) + 1;
+    size_t len = used - 1;
+    if(len && ibuf[ihead + len - 1] == '\r')
+        --len;
+    if(len >= max)
+        len = max - 1;
+
+    memcpy(data, ibuf + ihead, len);
+    data[len] = 0;
+    consume(used);
+    return used;
+}
+
+size_t TCPReactor::connection::write(const void *data, size_t size)
+{
+    assert(data != NULL || !size);
+
+    if(ioerr)
+        return 0;
+
+    if(otail + size > bufsize) {
+        flush();
+        if(ohead) {
+            memmove(obuf, obuf + ohead, otail - ohead);
+            otail -= ohead;
+            ohead = 0;
+        }
+    }
+
+    if(size > bufsize - otail)
+        size = bufsize - otail;
+
+    memcpy(obuf + otail, data, size);
+    otail += size;
+    return size;
+}
+
+size_t TCPReactor::connection::writes(const char *str)
+{
+    if(!str || !*str)
+        return 0;
+
+    return write(str, strlen(str));
+}
+
+TCPReactor::TCPReactor(const char *address, const char *service, unsigned count, unsigned backlog, size_t size) :
+TCPServer(address, service, backlog), Conditional()
+{
+    if(!count)
+        count = Thread::cpus();
+
+    if(!size)
+        size = REACTOR_BUFSIZE;
+
+    threads = NULL;
+    workers = count;
+    bufsize = size;
+    head = tail = NULL;
+    clients = 0;
+    running = false;
+    events = -1;
+    wakeup[0] = wakeup[1] = INVALID_SOCKET;
+
+    if(so != INVALID_SOCKET)
+        Socket::blocking(so, false);
+
+#ifndef _MSWINDOWS_
+    int fds[2];
+    if(!::pipe(fds)) {
+        wakeup[0] = fds[0];
+        wakeup[1] = fds[1];
+        Socket::blocking(wakeup[0], false);
+        Socket::blocking(wakeup[1], false);
+    }
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H)
+    events = epoll_create(REACTOR_EVENTS);
+    if(events != -1) {
+        struct epoll_event ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        if(so != INVALID_SOCKET)
+            epoll_ctl(events, EPOLL_CTL_ADD, so, &ev);
+        ev.data.ptr = this;
+        if(wakeup[0] != INVALID_SOCKET)
+            epoll_ctl(events, EPOLL_CTL_ADD, wakeup[0], &ev);
+    }
+#endif
+}
+
+TCPReactor::~TCPReactor()
+{
+    stop();
+
+#ifndef _MSWINDOWS_
+    if(events != -1)
+        ::close(events);
+    if(wakeup[0] != INVALID_SOCKET)
+        ::close(wakeup[0]);
+    if(wakeup[1] != INVALID_SOCKET)
+        ::close(wakeup[1]);
+#endif
+}
+
+TCPReactor::connection *TCPReactor::create(socket_t socket, size_t size)
+{
+    return new connection(socket, size);
+}
+
+bool TCPReactor::accepted(connection *client)
+{
+    __UNUSED(client);
+    return true;
+}
+
+void TCPReactor::disconnect(connection *client)
+{
+    __UNUSED(client);
+}
+
+void TCPReactor::start(int priority)
+{
+    if(running || so == INVALID_SOCKET)
+        return;
+
+    running = true;
+    threads = new loop *[workers + 1];
+    for(unsigned pos = 0; pos <= workers; ++pos) {
+        threads[pos] = new loop(this, pos == 0);
+        threads[pos]->start(priority);
+    }
+}
+
+void TCPReactor::stop(void)
+{
+    if(!running)
+        return;
+
+    lock();
+    running = false;
+    Conditional::broadcast();
+    unlock();
+    wake();
+
+    for(unsigned pos = 0; pos <= workers; ++pos)
+        delete threads[pos];
+
+    delete[] threads;
+    threads = NULL;
+    head = tail = NULL;
+
+    while(active.begin())
+        drop(static_cast<connection *>(active.begin()));
+}
+
+void TCPReactor::wake(void)
+{
+#ifndef _MSWINDOWS_
+    if(wakeup[1] != INVALID_SOCKET) {
+        ssize_t result = ::write(wakeup[1], "", 1);
+        (void)result;
+    }
+#endif
+}
+
+void TCPReactor::queue(connection *client)
+{
+    lock();
+    client->busy = true;
+    client->queued = NULL;
+    if(tail)
+        tail->queued = client;
+    else
+        head = client;
+    tail = client;
+    Conditional::signal();
+    unlock();
+}
+
+void TCPReactor::arm(connection *client)
+{
+    lock();
+    client->busy = false;
+    unlock();
+
+#if defined(HAVE_SYS_EPOLL_H)
+    if(events != -1) {
+        struct epoll_event ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLET | EPOLLONESHOT;
+        if(!client->closing)
+            ev.events |= EPOLLIN | EPOLLRDHUP;
+        if(client->pending())
+            ev.events |= EPOLLOUT;
+        ev.data.ptr = client;
+        epoll_ctl(events, EPOLL_CTL_MOD, client->so, &ev);
+        return;
+    }
+#endif
+
+    // poll dispatcher must rebuild its descriptor list...
+    wake();
+}
+
+void TCPReactor::drop(connection *client)
+{
+    lock();
+    client->delist();
+    --clients;
+    unlock();
+
+#if defined(HAVE_SYS_EPOLL_H)
+    if(events != -1) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        epoll_ctl(events, EPOLL_CTL_DEL, client->so, &ev);
+    }
+#endif
+
+    disconnect(client);
+    hangup(client->so);
+    delete client;
+}
+
+void TCPReactor::accepting(void)
+{
+    struct sockaddr_storage addr;
+
+    for(;;) {
+        socket_t client = ListenSocket::accept(&addr);
+        if(client == INVALID_SOCKET)
+            return;
+
+        Socket::blocking(client, false);
+        connection *cp = create(client, bufsize);
+        memcpy(&cp->peer, &addr, sizeof(addr));
+        if(!accepted(cp)) {
+            hangup(client);
+            delete cp;
+            continue;
+        }
+
+        lock();
+        cp->enlist(&active);
+        ++clients;
+        unlock();
+
+#if defined(HAVE_SYS_EPOLL_H)
+        if(events != -1) {
+            struct epoll_event ev;
+
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+            ev.data.ptr = cp;
+            if(epoll_ctl(events, EPOLL_CTL_ADD, client, &ev))
+                drop(cp);
+        }
+#endif
+    }
+}
+
+void TCPReactor::dispatch(void)
+{
+    char flush[32];
+
+#if defined(HAVE_SYS_EPOLL_H)
+    if(events != -1) {
+        struct epoll_event list[REACTOR_EVENTS];
+
+        while(running) {
+            int count = epoll_wait(events, list, REACTOR_EVENTS, -1);
+            if(count < 0) {
+                if(errno == EINTR)
+                    continue;
+                break;
+            }
+            for(int pos = 0; pos < count; ++pos) {
+                void *ptr = list[pos].data.ptr;
+                if(ptr == NULL)
+                    accepting();
+                else if(ptr == this) {
+                    while(::read(wakeup[0], flush, sizeof(flush)) > 0)
+                        ;
+                }
+                else
+                    queue(static_cast<connection *>(ptr));
+            }
+        }
+        return;
+    }
+#endif
+
+    struct pollfd *fds = NULL;
+    connection **map = NULL;
+    unsigned size = 0;
+    timeout_t timeout = (wakeup[0] == INVALID_SOCKET) ? 100 : Timer::inf;
+
+    while(running) {
+        unsigned count = 0, first;
+
+        lock();
+        if(clients + 2 > size) {
+            size = clients + 32;
+            fds = (struct pollfd *)realloc(fds, sizeof(struct pollfd) * size);
+            map = (connection **)realloc(map, sizeof(connection *) * size);
+            if(!fds || !map) {
+                unlock();
+                __THROW_ALLOC();
+            }
+        }
+        fds[count].fd = so;
+        fds[count].events = POLLIN;
+        fds[count++].revents = 0;
+        if(wakeup[0] != INVALID_SOCKET) {
+            fds[count].fd = wakeup[0];
+            fds[count].events = POLLIN;
+            fds[count++].revents = 0;
+        }
+        first = count;
+        linked_pointer<connection> cp = active.begin();
+        while(is(cp)) {
+            if(!cp->busy) {
+                map[count] = *cp;
+                fds[count].fd = cp->so;
+                fds[count].events = cp->closing ? 0 : POLLIN;
+                if(cp->pending())
+                    fds[count].events |= POLLOUT;
+                fds[count++].revents = 0;
+            }
+            cp.next();
+        }
+        unlock();
+
+        int result = poll(fds, count, (timeout == Timer::inf) ? -1 : (int)timeout);
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        if(first > 1 && fds[1].revents) {
+            while(::read(wakeup[0], flush, sizeof(flush)) > 0)
+                ;
+        }
+
+        for(unsigned pos = first; pos < count; ++pos) {
+            if(fds[pos].revents)
+                queue(map[pos]);
+        }
+
+        if(fds[0].revents)
+            accepting();
+    }
+
+    if(fds)
+        ::free(fds);
+    if(map)
+        ::free(map);
+}
+
+void TCPReactor::service(void)
+{
+    for(;;) {
+        lock();
+        while(running && !head)
+            Conditional::wait();
+
+        if(!running) {
+            unlock();
+            return;
+        }
+
+        connection *client = head;
+        head = client->queued;
+        if(!head)
+            tail = NULL;
+        unlock();
+
+        service(client);
+    }
+}
+
+void TCPReactor::service(connection *client)
+{
+    bool more = false;
+
+    do {
+        if(!client->closing) {
+            more = client->fill();
+            size_t prior = client->available();
+            if(prior) {
+                input(client);
+                // a full buffer the server cannot consume...
+                if(more && client->available() >= prior)
+                    client->closing = true;
+            }
+        }
+        client->flush();
+    } while(more && !client->closing && !client->ioerr);
+
+    if(client->eof)
+        client->closing = true;
+
+    if(client->ioerr || (client->closing && !client->pending())) {
+        drop(client);
+        return;
+    }
+
+    arm(client);
+}
+
+} // namespace ucommon
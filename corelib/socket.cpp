@@ -23,6 +23,7 @@
 #include <ucommon/typeref.h>
 #include <ucommon/thread.h>
 #include <ucommon/fsys.h>
+#include <ucommon/hash.h>
 #ifndef _MSWINDOWS_
 #include <net/if.h>
 #include <sys/un.h>
@@ -46,6 +47,14 @@
 #include <sys/filio.h>
 #endif
 
+#ifdef  HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+#include <sys/mman.h>
+#endif
+
 #if defined(HAVE_POLL) && defined(POLLRDNORM)
 #define USE_POLL
 #endif
@@ -652,6 +661,297 @@ const cidr *cidr::container(const policy *policy, const struct sockaddr *s)
 }
 
 
+class __LOCAL cidr::table::node
+{
+public:
+    class member
+    {
+    public:
+        member *next;
+        const cidr *object;
+    };
+
+    node *child[2];
+    member *list;
+    unsigned bits;
+    uint8_t key[16];
+
+    node(const uint8_t *prefix, unsigned size) {
+        child[0] = child[1] = NULL;
+        list = NULL;
+        bits = size;
+        memset(key, 0, sizeof(key));
+        memcpy(key, prefix, (size + 7) / 8);
+        if(size % 8)
+            key[size / 8] &= (uint8_t)(0xff << (8 - (size % 8)));
+    }
+
+    ~node() {
+        while(list) {
+            member *next = list->next;
+            delete list;
+            list = next;
+        }
+    }
+
+    static inline unsigned bit(const uint8_t *key, unsigned pos) {
+        return (key[pos / 8] >> (7 - (pos % 8))) & 1;
+    }
+
+    // number of leading bits key shares with our prefix
+    unsigned common(const uint8_t *from, unsigned limit) const {
+        unsigned pos = 0;
+        while(pos + 8 <= limit && key[pos / 8] == from[pos / 8])
+            pos += 8;
+        while(pos < limit && bit(key, pos) == bit(from, pos))
+            ++pos;
+        return pos;
+    }
+
+    inline bool match(const uint8_t *from) const {
+        return common(from, bits) == bits;
+    }
+
+    static void release(node *n) {
+        if(!n)
+            return;
+        release(n->child[0]);
+        release(n->child[1]);
+        delete n;
+    }
+
+    // drop nodes that no longer hold entries or branch
+    static node *collapse(node *n) {
+        if(n->list || (n->child[0] && n->child[1]))
+            return n;
+        node *next = n->child[0] ? n->child[0] : n->child[1];
+        delete n;
+        return next;
+    }
+
+    static node *remove(node *n, const uint8_t *key, unsigned bits, const cidr *entry, bool& found) {
+        if(!n || n->bits > bits || !n->match(key))
+            return n;
+
+        if(n->bits < bits) {
+            unsigned side = bit(key, n->bits);
+            n->child[side] = remove(n->child[side], key, bits, entry, found);
+            return collapse(n);
+        }
+
+        member **mp = &n->list;
+        while(*mp) {
+            if((*mp)->object == entry) {
+                member *next = (*mp)->next;
+                delete *mp;
+                *mp = next;
+                found = true;
+                break;
+            }
+            mp = &(*mp)->next;
+        }
+        return collapse(n);
+    }
+};
+
+static unsigned family_bits(int family)
+{
+    if(family == AF_INET)
+        return 32;
+    return 128;
+}
+
+static const uint8_t *cidr_key(const struct sockaddr *s, int& family)
+{
+    const struct sockaddr_internet *addr = (const struct sockaddr_internet *)s;
+
+    family = s->sa_family;
+    switch(family) {
+    case AF_INET:
+        return (const uint8_t *)&addr->ipv4.sin_addr;
+#ifdef  AF_INET6
+    case AF_INET6:
+        return (const uint8_t *)&addr->ipv6.sin6_addr;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+cidr::table::table()
+{
+    inet4 = inet6 = NULL;
+    count = 0;
+}
+
+cidr::table::table(const policy *list)
+{
+    inet4 = inet6 = NULL;
+    count = 0;
+    add(list);
+}
+
+cidr::table::~table()
+{
+    clear();
+}
+
+cidr::table::node **cidr::table::root(int family)
+{
+    switch(family) {
+    case AF_INET:
+        return &inet4;
+#ifdef  AF_INET6
+    case AF_INET6:
+        return &inet6;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+const cidr::table::node *cidr::table::root(int family) const
+{
+    switch(family) {
+    case AF_INET:
+        return inet4;
+#ifdef  AF_INET6
+    case AF_INET6:
+        return inet6;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+void cidr::table::clear(void)
+{
+    node::release(inet4);
+    node::release(inet6);
+    inet4 = inet6 = NULL;
+    count = 0;
+}
+
+void cidr::table::add(const policy *list)
+{
+    linked_pointer<const cidr> p = list;
+    while(p) {
+        insert(*p);
+        p.next();
+    }
+}
+
+void cidr::table::insert(const cidr *entry)
+{
+    assert(entry != NULL);
+
+    node **link = root(entry->Family);
+    node *n, *branch;
+    unsigned bits = entry->mask(), same;
+    const uint8_t *key = (const uint8_t *)&entry->Network;
+
+    if(!link)
+        return;
+
+    for(;;) {
+        n = *link;
+        if(!n) {
+            n = *link = new node(key, bits);
+            break;
+        }
+
+        same = n->common(key, bits < n->bits ? bits : n->bits);
+        if(same < n->bits) {
+            // split existing node at point of difference
+            branch = new node(key, same);
+            branch->child[node::bit(n->key, same)] = n;
+            *link = branch;
+            if(same == bits) {
+                n = branch;
+                break;
+            }
+            n = branch->child[node::bit(key, same)] = new node(key, bits);
+            break;
+        }
+
+        if(n->bits == bits)
+            break;
+
+        link = &n->child[node::bit(key, n->bits)];
+    }
+
+    node::member *m = new node::member;
+    m->next = NULL;
+    m->object = entry;
+
+    node::member **mp = &n->list;
+    while(*mp)
+        mp = &(*mp)->next;
+    *mp = m;
+    ++count;
+}
+
+bool cidr::table::remove(const cidr *entry)
+{
+    assert(entry != NULL);
+
+    node **link = root(entry->Family);
+    bool found = false;
+
+    if(!link)
+        return false;
+
+    *link = node::remove(*link, (const uint8_t *)&entry->Network, entry->mask(), entry, found);
+    if(found)
+        --count;
+    return found;
+}
+
+const cidr *cidr::table::find(const struct sockaddr *s) const
+{
+    assert(s != NULL);
+
+    int family;
+    const uint8_t *key = cidr_key(s, family);
+    const node *n = root(family);
+    const cidr *member = NULL;
+
+    if(!key)
+        return NULL;
+
+    // deepest matching node holding entries is the longest prefix
+    while(n && n->match(key)) {
+        if(n->list && n->bits)
+            member = n->list->object;
+        if(n->bits >= family_bits(family))
+            break;
+        n = n->child[node::bit(key, n->bits)];
+    }
+    return member;
+}
+
+const cidr *cidr::table::container(const struct sockaddr *s) const
+{
+    assert(s != NULL);
+
+    int family;
+    const uint8_t *key = cidr_key(s, family);
+    const node *n = root(family);
+
+    if(!key)
+        return NULL;
+
+    // first matching node holding entries is the shortest prefix
+    while(n && n->match(key)) {
+        if(n->list && n->bits < 128)
+            return n->list->object;
+        if(n->bits >= family_bits(family))
+            break;
+        n = n->child[node::bit(key, n->bits)];
+    }
+    return NULL;
+}
+
 bool cidr::is_member(const struct sockaddr *s) const
 {
     assert(s != NULL);
@@ -828,7 +1128,7 @@ void cidr::set(const char *cp)
         memset(&Netmask.ipv6, 0, sizeof(Netmask));
         bitset((bit_t *)&Netmask.ipv6, mask(cp));
         String::set(cbuf, sizeof(cbuf), cp);
-        ep = (char *)strchr(cp, '/');
+        ep = (char *)strchr(cbuf, '/');
         if(ep)
             *ep = 0;
 #ifdef  _MSWINDOWS_
@@ -1583,6 +1883,7 @@ Socket::Socket(const Socket &s)
 #endif
     iowait = s.iowait;
     ioerr = 0;
+    input = NULL;
 }
 
 Socket::Socket()
@@ -1590,6 +1891,7 @@ Socket::Socket()
     so = INVALID_SOCKET;
     iowait = Timer::inf;
     ioerr = 0;
+    input = NULL;
 }
 
 Socket::Socket(const socket_t s)
@@ -1597,10 +1899,12 @@ Socket::Socket(const socket_t s)
     so = s;
     iowait = Timer::inf;
     ioerr = 0;
+    input = NULL;
 }
 
 Socket::Socket(const struct addrinfo *addr)
 {
+    input = NULL;
 #ifdef  _MSWINDOWS_
     init();
 #endif
@@ -1625,6 +1929,7 @@ Socket::Socket(int family, int type, int protocol)
     so = create(family, type, protocol);
     iowait = Timer::inf;
     ioerr = 0;
+    input = NULL;
 }
 
 Socket::Socket(const char *iface, const char *port, int family, int type, int protocol)
@@ -1639,6 +1944,7 @@ Socket::Socket(const char *iface, const char *port, int family, int type, int pr
     so = create(iface, port, family, type, protocol);
     iowait = Timer::inf;
     ioerr = 0;
+    input = NULL;
 }
 
 socket_t Socket::create(const Socket::address &address)
@@ -1763,6 +2069,11 @@ void Socket::release(socket_t so)
 
 void Socket::release(void)
 {
+    if(input) {
+        delete input;
+        input = NULL;
+    }
+
     if(so != INVALID_SOCKET) {
 #ifdef  _MSWINDOWS_
         ::closesocket(so);
@@ -1878,6 +2189,9 @@ size_t Socket::peek(void *data, size_t len) const
     assert(data != NULL);
     assert(len > 0);
 
+    if(input && input->available())
+        return input->peek(data, 1);
+
     if(iowait && iowait != Timer::inf && !Socket::wait(so, iowait))
         return 0;
 
@@ -1901,6 +2215,18 @@ size_t Socket::readfrom(void *data, size_t len, struct sockaddr_storage *from)
     assert(data != NULL);
     assert(len > 0);
 
+    if(input) {
+        if(!input->available() && iowait && iowait != Timer::inf && !Socket::wait(so, iowait))
+            return 0;
+
+        ssize_t result = input->read(data, len);
+        if(result < 0) {
+            ioerr = input->err();
+            return 0;
+        }
+        return (size_t)result;
+    }
+
     // wait for input by timer if possible...
     if(iowait && iowait != Timer::inf && !Socket::wait(so, iowait))
         return 0;
@@ -1945,6 +2271,356 @@ ssize_t Socket::sendto(socket_t so, const void *data, size_t dlen, int flags, co
     return ::sendto(so, (caddr_t)data, (socksize_t)dlen, MSG_NOSIGNAL | flags, dest, (socklen_t)slen);
 }
 
+// batch size of mmsg calls kept on stack...
+#define MMSG_BATCH   32
+
+int Socket::recvmsgs(socket_t so, datagram *list, unsigned count, int flags)
+{
+    assert(list != NULL);
+
+    unsigned total = 0;
+    int result;
+
+#ifdef  HAVE_RECVMMSG
+    struct mmsghdr msgs[MMSG_BATCH];
+    struct iovec iov[MMSG_BATCH];
+    unsigned pos, chunk;
+
+#ifdef  MSG_WAITFORONE
+    flags |= MSG_WAITFORONE;
+#endif
+
+    while(total < count) {
+        chunk = count - total;
+        if(chunk > MMSG_BATCH)
+            chunk = MMSG_BATCH;
+
+        memset(msgs, 0, sizeof(struct mmsghdr) * chunk);
+        for(pos = 0; pos < chunk; ++pos) {
+            iov[pos].iov_base = list[total + pos].data;
+            iov[pos].iov_len = list[total + pos].size;
+            msgs[pos].msg_hdr.msg_iov = &iov[pos];
+            msgs[pos].msg_hdr.msg_iovlen = 1;
+            msgs[pos].msg_hdr.msg_name = &list[total + pos].peer;
+            msgs[pos].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+
+        result = ::recvmmsg(so, msgs, chunk, flags, NULL);
+        if(result < 0)
+            break;
+
+        for(pos = 0; pos < (unsigned)result; ++pos)
+            list[total + pos].result = msgs[pos].msg_len;
+
+        total += result;
+        if((unsigned)result < chunk)
+            break;
+
+        // only wait for the first datagram...
+        flags |= MSG_DONTWAIT;
+    }
+#else
+    while(total < count) {
+        // without MSG_DONTWAIT later reads would block, so only take
+        // what is already queued once the first datagram is in...
+        if(total && !MSG_DONTWAIT && !wait(so, 0))
+            break;
+
+        result = (int)recvfrom(so, list[total].data, list[total].size, flags, &list[total].peer);
+        if(result < 0)
+            break;
+
+        list[total++].result = (size_t)result;
+        flags |= MSG_DONTWAIT;
+    }
+#endif
+
+    if(!total && count)
+        return -1;
+
+    return (int)total;
+}
+
+int Socket::sendmsgs(socket_t so, datagram *list, unsigned count, int flags)
+{
+    assert(list != NULL);
+
+    unsigned total = 0;
+    int result;
+
+#ifdef  HAVE_SENDMMSG
+    struct mmsghdr msgs[MMSG_BATCH];
+    struct iovec iov[MMSG_BATCH];
+    unsigned pos, chunk;
+
+    while(total < count) {
+        chunk = count - total;
+        if(chunk > MMSG_BATCH)
+            chunk = MMSG_BATCH;
+
+        memset(msgs, 0, sizeof(struct mmsghdr) * chunk);
+        for(pos = 0; pos < chunk; ++pos) {
+            struct sockaddr *dest = (struct sockaddr *)&list[total + pos].peer;
+            iov[pos].iov_base = list[total + pos].data;
+            iov[pos].iov_len = list[total + pos].size;
+            msgs[pos].msg_hdr.msg_iov = &iov[pos];
+            msgs[pos].msg_hdr.msg_iovlen = 1;
+            if(dest->sa_family) {
+                msgs[pos].msg_hdr.msg_name = dest;
+                msgs[pos].msg_hdr.msg_namelen = len(dest);
+            }
+        }
+
+        result = ::sendmmsg(so, msgs, chunk, MSG_NOSIGNAL | flags);
+        if(result < 0)
+            break;
+
+        for(pos = 0; pos < (unsigned)result; ++pos)
+            list[total + pos].result = msgs[pos].msg_len;
+
+        total += result;
+        if((unsigned)result < chunk)
+            break;
+    }
+#else
+    while(total < count) {
+        struct sockaddr *dest = (struct sockaddr *)&list[total].peer;
+        if(!dest->sa_family)
+            dest = NULL;
+
+        result = (int)sendto(so, list[total].data, list[total].size, flags, dest);
+        if(result < 0)
+            break;
+
+        list[total++].result = (size_t)result;
+    }
+#endif
+
+    if(!total && count)
+        return -1;
+
+    return (int)total;
+}
+
+// send a block of memory, returning bytes sent or -1 if none
+static ssize_t sendall(socket_t so, const char *data, size_t size)
+{
+    size_t total = 0;
+    ssize_t result;
+
+    while(total < size) {
+        result = Socket::sendto(so, data + total, size - total);
+        if(result < 0 && errno == EINTR)
+            continue;
+        if(result < 1)
+            break;
+        total += result;
+    }
+
+    if(!total && size)
+        return -1;
+    return (ssize_t)total;
+}
+
+ssize_t Socket::sendfile(socket_t so, fsys& file, fsys::offset_t offset, size_t size)
+{
+    size_t total = 0;
+    ssize_t result;
+
+    if(!size)
+        return 0;
+
+#ifndef _MSWINDOWS_
+    struct stat ino;
+    int fd = *file;
+
+    if(fd < 0 || ::fstat(fd, &ino))
+        return -1;
+
+    if(offset >= ino.st_size)
+        return 0;
+
+    if(size > (size_t)(ino.st_size - offset))
+        size = (size_t)(ino.st_size - offset);
+
+#ifdef  HAVE_SYS_SENDFILE_H
+    off_t pos = offset;
+    while(total < size) {
+        result = ::sendfile(so, fd, &pos, size - total);
+        if(result < 0 && errno == EINTR)
+            continue;
+        if(result < 0 && !total && (errno == EINVAL || errno == ENOSYS))
+            break;
+        if(result < 0)
+            return total ? (ssize_t)total : -1;
+        if(!result)
+            return (ssize_t)total;
+        total += result;
+    }
+
+    if(total)
+        return (ssize_t)total;
+#endif
+
+#ifdef  HAVE_SYS_MMAN_H
+    long page = sysconf(_SC_PAGESIZE);
+    off_t base = offset - (offset % page);
+    size_t skip = (size_t)(offset - base);
+    caddr_t map = (caddr_t)mmap(NULL, size + skip, PROT_READ, MAP_SHARED, fd, base);
+
+    if(map != (caddr_t)MAP_FAILED) {
+        result = sendall(so, map + skip, size);
+        munmap(map, size + skip);
+        return result;
+    }
+#endif
+#endif
+
+    // buffered fallback...
+    char *buffer = new char[65536];
+    size_t len;
+
+    result = 0;
+
+    if(file.seek(offset)) {
+        delete[] buffer;
+        return -1;
+    }
+
+    while(total < size) {
+        len = size - total;
+        if(len > 65536)
+            len = 65536;
+        result = file.read(buffer, len);
+        if(result < 1)
+            break;
+        len = (size_t)result;
+        result = sendall(so, buffer, len);
+        if(result < 0)
+            break;
+        total += result;
+        if((size_t)result < len)
+            break;
+    }
+
+    delete[] buffer;
+    if(!total && result < 0)
+        return -1;
+    return (ssize_t)total;
+}
+
+size_t Socket::sendfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    ssize_t result = sendfile(so, file, offset, size);
+    if(result < 0) {
+        ioerr = Socket::error();
+        return 0;
+    }
+    return (size_t)result;
+}
+
+unsigned Socket::readmsgs(datagram *list, unsigned count)
+{
+    assert(list != NULL);
+
+    if(!count)
+        return 0;
+
+    if(iowait && iowait != Timer::inf && !Socket::wait(so, iowait))
+        return 0;
+
+    int result = recvmsgs(so, list, count);
+    if(result < 0) {
+        ioerr = Socket::error();
+        return 0;
+    }
+    return (unsigned)result;
+}
+
+unsigned Socket::writemsgs(datagram *list, unsigned count)
+{
+    assert(list != NULL);
+
+    if(!count)
+        return 0;
+
+    int result = sendmsgs(so, list, count);
+    if(result < 0) {
+        ioerr = Socket::error();
+        return 0;
+    }
+    return (unsigned)result;
+}
+
+#ifndef _MSWINDOWS_
+ssize_t Socket::recvv(socket_t so, const struct iovec *list, unsigned count, int flags)
+{
+    assert(list != NULL);
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec *)list;
+    msg.msg_iovlen = count;
+
+    return ::recvmsg(so, &msg, flags);
+}
+
+ssize_t Socket::sendv(socket_t so, const struct iovec *list, unsigned count, int flags)
+{
+    assert(list != NULL);
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec *)list;
+    msg.msg_iovlen = count;
+
+    return ::sendmsg(so, &msg, MSG_NOSIGNAL | flags);
+}
+
+size_t Socket::readv(const struct iovec *list, unsigned count)
+{
+    assert(list != NULL);
+
+    size_t total = 0;
+    unsigned pos = 0;
+    ssize_t result;
+
+    // consume buffered input first...
+    while(input && input->available() && pos < count) {
+        result = input->read(list[pos].iov_base, list[pos].iov_len);
+        total += result;
+        if((size_t)result < list[pos].iov_len)
+            return total;
+        ++pos;
+    }
+
+    if(total || pos >= count)
+        return total;
+
+    if(iowait && iowait != Timer::inf && !Socket::wait(so, iowait))
+        return 0;
+
+    result = recvv(so, list, count);
+    if(result < 0) {
+        ioerr = Socket::error();
+        return 0;
+    }
+    return (size_t)result;
+}
+
+size_t Socket::writev(const struct iovec *list, unsigned count)
+{
+    assert(list != NULL);
+
+    ssize_t result = sendv(so, list, count);
+    if(result < 0) {
+        ioerr = Socket::error();
+        return 0;
+    }
+    return (size_t)result;
+}
+#endif
+
 size_t Socket::writes(const char *str)
 {
     if(!str)
@@ -1963,7 +2639,11 @@ size_t Socket::readline(char *data, size_t max)
 
     *data = 0;
 
-    ssize_t result = Socket::readline(so, data, max, iowait);
+    ssize_t result;
+    if(input)
+        result = input->readline(data, max, iowait);
+    else
+        result = Socket::readline(so, data, max, iowait);
     if(result < 0) {
         ioerr = Socket::error();
         return 0;
@@ -1976,7 +2656,11 @@ size_t Socket::readline(String& s)
     if(!s.data())
         return 0;
 
-    ssize_t result = Socket::readline(so, s.data(), s.size() + 1, iowait);
+    ssize_t result;
+    if(input)
+        result = input->readline(s.data(), s.size() + 1, iowait);
+    else
+        result = Socket::readline(so, s.data(), s.size() + 1, iowait);
     if(result < 0) {
         ioerr = Socket::error();
         s.clear();
@@ -1992,7 +2676,11 @@ stringref_t Socket::readline(size_t size)
 	if(!buf)
 		return stringref_t();
 
-	ssize_t result = Socket::readline(so, buf->get(), buf->max() + 1, iowait);
+	ssize_t result;
+	if(input)
+		result = input->readline(buf->get(), buf->max() + 1, iowait);
+	else
+		result = Socket::readline(so, buf->get(), buf->max() + 1, iowait);
 	if(result < 0)
 		return stringref_t();
 
@@ -2057,6 +2745,183 @@ ssize_t Socket::readline(socket_t so, char *data, size_t max, timeout_t timeout)
     return ssize_t(max - nleft - 1);
 }
 
+Socket::reader::reader(socket_t socket, size_t size)
+{
+    assert(size > 0);
+
+    so = socket;
+    bufsize = size;
+    buffer = new char[size + 1];
+    head = tail = scan = 0;
+    eol = false;
+    ioerr = 0;
+}
+
+Socket::reader::~reader()
+{
+    delete[] buffer;
+}
+
+bool Socket::reader::fill(timeout_t timeout)
+{
+    if(head == tail)
+        head = tail = scan = 0;
+    else if(tail == bufsize && head) {
+        memmove(buffer, buffer + head, tail - head);
+        tail -= head;
+        scan -= head;
+        head = 0;
+    }
+
+    if(timeout && !Socket::wait(so, timeout))
+        return false;
+
+    ssize_t result = ::recv(so, buffer + tail, (socksize_t)(bufsize - tail), 0);
+    if(result < 0) {
+        ioerr = Socket::error();
+        return false;
+    }
+    if(!result)
+        return false;
+
+    tail += result;
+    return true;
+}
+
+char *Socket::reader::next(size_t *size, size_t limit, timeout_t timeout)
+{
+    char *nl, *line;
+    size_t len, end;
+
+    *size = 0;
+    eol = false;
+    ioerr = 0;
+
+    for(;;) {
+        // a line of limit bytes may still be followed by its newline...
+        end = tail;
+        if(end - head > limit)
+            end = head + limit + 1;
+
+        nl = NULL;
+        if(scan < end)
+            nl = (char *)memchr(buffer + scan, '\n', end - scan);
+
+        line = buffer + head;
+        if(nl) {
+            eol = true;
+            len = (size_t)(nl - line);
+            head = scan = (size_t)(nl - buffer) + 1;
+            if(len && line[len - 1] == '\r')
+                --len;
+            break;
+        }
+
+        scan = end;
+
+        // return partial line if longer than limit or buffer...
+        if(tail - head > limit || tail - head == bufsize) {
+            len = tail - head;
+            if(len > limit)
+                len = limit;
+            head += len;
+            if(scan < head)
+                scan = head;
+            break;
+        }
+
+        if(!fill(timeout)) {
+            // return unterminated last line at eof...
+            if(ioerr || head == tail)
+                return NULL;
+            line = buffer + head;
+            len = tail - head;
+            head = scan = tail;
+            break;
+        }
+    }
+
+    *size = len;
+    return line;
+}
+
+const char *Socket::reader::getline(size_t *size, timeout_t timeout)
+{
+    assert(size != NULL);
+
+    char *line = next(size, bufsize, timeout);
+    if(line)
+        line[*size] = 0;
+    return line;
+}
+
+ssize_t Socket::reader::readline(char *data, size_t max, timeout_t timeout)
+{
+    assert(data != NULL);
+    assert(max > 0);
+
+    size_t len;
+    const char *line = next(&len, max - 1, timeout);
+
+    data[0] = 0;
+    if(!line)
+        return ioerr ? -1 : 0;
+
+    memcpy(data, line, len);
+    data[len] = 0;
+    if(eol)
+        ++len;
+    return (ssize_t)len;
+}
+
+ssize_t Socket::reader::read(void *data, size_t size)
+{
+    assert(data != NULL);
+
+    size_t len = tail - head;
+    ioerr = 0;
+
+    if(!len) {
+        ssize_t result = ::recv(so, (caddr_t)data, (socksize_t)size, 0);
+        if(result < 0)
+            ioerr = Socket::error();
+        return result;
+    }
+
+    if(len > size)
+        len = size;
+
+    memcpy(data, buffer + head, len);
+    head += len;
+    if(scan < head)
+        scan = head;
+    return (ssize_t)len;
+}
+
+size_t Socket::reader::peek(void *data, size_t size) const
+{
+    assert(data != NULL);
+
+    size_t len = tail - head;
+    if(len > size)
+        len = size;
+
+    if(len)
+        memcpy(data, buffer + head, len);
+    return len;
+}
+
+void Socket::buffering(size_t size)
+{
+    if(input) {
+        delete input;
+        input = NULL;
+    }
+
+    if(size && so != INVALID_SOCKET)
+        input = new reader(so, size);
+}
+
 int Socket::loopback(socket_t so, bool enable)
 {
     union {
@@ -2620,6 +3485,14 @@ bool Socket::connected(void) const
     return true;
 }
 
+unsigned Socket::pending(void) const
+{
+    if(input)
+        return pending(so) + (unsigned)input->available();
+
+    return pending(so);
+}
+
 bool Socket::is_pending(unsigned qio)
 {
     if(pending() >= qio)
@@ -2664,6 +3537,9 @@ socket_t Socket::acceptfrom(socket_t so, struct sockaddr_storage *addr)
 
 bool Socket::wait(timeout_t timeout) const
 {
+    if(input && input->available())
+        return true;
+
     return wait(so, timeout);
 }
 
@@ -3059,10 +3935,9 @@ unsigned Socket::keyhost(const struct sockaddr *addr, unsigned keysize)
     assert(addr != NULL);
     assert(keysize > 0);
 
-    unsigned key = 0;
     caddr_t cp = NULL;
     unsigned len;
-switch(addr->sa_family) {
+    switch(addr->sa_family) {
 #ifdef  AF_INET6
     case AF_INET6:
         cp = (caddr_t)(&((const struct sockaddr_in6 *)(addr))->sin6_addr);
@@ -3076,11 +3951,7 @@ switch(addr->sa_family) {
     default:
         return 0;
     }
-    while(len--) {
-        key = key << 1;
-        key ^= cp[len];
-    }
-    return key % keysize;
+    return (unsigned)(Hash::get(cp, len) % keysize);
 }
 
 unsigned Socket::keyindex(const struct sockaddr *addr, unsigned keysize)
@@ -3088,30 +3959,23 @@ unsigned Socket::keyindex(const struct sockaddr *addr, unsigned keysize)
     assert(addr != NULL);
     assert(keysize > 0);
 
-    unsigned key = 0;
     caddr_t cp = NULL;
     unsigned len;
-switch(addr->sa_family) {
+    switch(addr->sa_family) {
 #ifdef  AF_INET6
     case AF_INET6:
         cp = (caddr_t)(&((const struct sockaddr_in6 *)(addr))->sin6_addr);
         len = 16;
-        key = port(addr);
         break;
 #endif
     case AF_INET:
         cp = (caddr_t)(&((const struct sockaddr_in *)(addr))->sin_addr);
         len = 4;
-        key = port(addr);
         break;
     default:
         return 0;
     }
-    while(len--) {
-        key = key << 1;
-        key ^= cp[len];
-    }
-    return key % keysize;
+    return (unsigned)(Hash::mix(Hash::get(cp, len), port(addr)) % keysize);
 }
 
 in_port_t Socket::port(const struct sockaddr *addr)
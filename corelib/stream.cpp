@@ -42,6 +42,11 @@
 #include <sys/resource.h>
 #endif
 
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace ucommon {
 using std::iostream;
 using std::streambuf;
@@ -128,6 +133,7 @@ StreamBuffer()
 {
     so = Socket::create(Socket::family(copy.so), SOCK_STREAM, IPPROTO_TCP);
     timeout = copy.timeout;
+    bulk = false;
 }
 
 tcpstream::tcpstream(int family, timeout_t tv) :
@@ -135,6 +141,7 @@ StreamBuffer()
 {
     so = Socket::create(family, SOCK_STREAM, IPPROTO_TCP);
     timeout = tv;
+    bulk = false;
 }
 
 tcpstream::tcpstream(Socket::address& list, unsigned segsize, timeout_t tv) :
@@ -142,6 +149,7 @@ StreamBuffer()
 {
     so = Socket::create(list.family(), SOCK_STREAM, IPPROTO_TCP);
     timeout = tv;
+    bulk = false;
     open(list);
 }
 
@@ -150,6 +158,7 @@ StreamBuffer()
 {
     so = server->accept();
     timeout = tv;
+    bulk = false;
     if(so == INVALID_SOCKET) {
         clear(ios::failbit | rdstate());
         return;
@@ -182,7 +191,8 @@ bool tcpstream::_wait(void)
 
 ssize_t tcpstream::_read(char *buffer, size_t size)
 {
-    return Socket::recvfrom(so, buffer, size, MSG_WAITALL);
+    // bulk buffers are filled with whatever input is waiting
+    return Socket::recvfrom(so, buffer, size, bulk ? 0 : MSG_WAITALL);
 }
 
 ssize_t tcpstream::_write(const char *buffer, size_t size)
@@ -190,6 +200,180 @@ ssize_t tcpstream::_write(const char *buffer, size_t size)
     return Socket::sendto(so, buffer, size);
 }
 
+ssize_t tcpstream::_writev(const char *head, size_t hsize, const char *data, size_t dsize)
+{
+#ifndef _MSWINDOWS_
+    struct iovec iov[2];
+    unsigned count = 0;
+
+    if(hsize) {
+        iov[count].iov_base = (void *)head;
+        iov[count++].iov_len = hsize;
+    }
+    if(dsize) {
+        iov[count].iov_base = (void *)data;
+        iov[count++].iov_len = dsize;
+    }
+    return Socket::sendv(so, iov, count);
+#else
+    return _writes(head, hsize, data, dsize);
+#endif
+}
+
+ssize_t tcpstream::_writes(const char *head, size_t hsize, const char *data, size_t dsize)
+{
+    ssize_t result, total = 0;
+
+    if(hsize) {
+        result = _write(head, hsize);
+        if(result < (ssize_t)hsize)
+            return result;
+        total = result;
+    }
+
+    if(dsize) {
+        result = _write(data, dsize);
+        if(result < 0)
+            return total ? total : -1;
+        total += result;
+    }
+    return total;
+}
+
+std::streamsize tcpstream::xsgetn(char *data, std::streamsize size)
+{
+    if(!bulk || bufsize < 2 || !gptr())
+        return std::streambuf::xsgetn(data, size);
+
+    std::streamsize total = 0, len;
+    ssize_t result;
+
+    while(total < size) {
+        len = (std::streamsize)(egptr() - gptr());
+        if(len) {
+            if(len > size - total)
+                len = size - total;
+            memcpy(data + total, gptr(), (size_t)len);
+            gbump((int)len);
+            total += len;
+            continue;
+        }
+
+        // small remainder is buffered, large remainder read directly
+        if((size_t)(size - total) < bufsize) {
+            if(IS_EOF(underflow()))
+                break;
+            continue;
+        }
+
+        if(!_wait()) {
+            clear(ios::failbit | rdstate());
+            break;
+        }
+
+        result = _read(data + total, (size_t)(size - total));
+        if(result < 1) {
+            if(result < 0)
+                reset();
+            else
+                clear(ios::failbit | rdstate());
+            break;
+        }
+        total += result;
+    }
+    return total;
+}
+
+std::streamsize tcpstream::xsputn(const char *data, std::streamsize size)
+{
+    if(!bulk || bufsize < 2 || !pbase() || (size_t)size < bufsize)
+        return std::streambuf::xsputn(data, size);
+
+    const char *head = pbase();
+    size_t hsize = (size_t)(pptr() - pbase());
+    std::streamsize total = 0;
+    ssize_t result;
+
+    // send pending output and caller data in one gathered write
+    while(hsize || total < size) {
+        result = _writev(head, hsize, data + total, (size_t)(size - total));
+        if(result < 1) {
+            if(result < 0) {
+                reset();
+                return total;
+            }
+            break;
+        }
+        if((size_t)result < hsize) {
+            head += result;
+            hsize -= result;
+            continue;
+        }
+        result -= (ssize_t)hsize;
+        hsize = 0;
+        total += result;
+    }
+
+    if(hsize)
+        memmove(pbuf, head, hsize);
+    setp(pbuf, pbuf + bufsize);
+    pbump((int)hsize);
+    return total;
+}
+
+void tcpstream::buffering(size_t size)
+{
+    size_t unread = 0, pending = 0;
+
+    if(!bufsize || so == INVALID_SOCKET)
+        return;
+
+    if(size < 2)
+        size = 2;
+
+    if(bufsize > 1) {
+        overflow(EOF);
+        if(!bufsize)
+            return;
+        unread = (size_t)(egptr() - gptr());
+        pending = (size_t)(pptr() - pbase());
+    }
+
+    if(unread > size)
+        size = unread;
+
+    if(pending > size)
+        size = pending;
+
+    char *ng = new char[size];
+    char *np = new char[size];
+
+    if(unread)
+        memcpy(ng, gptr(), unread);
+    if(pending)
+        memcpy(np, pbase(), pending);
+
+    if(gbuf)
+        delete[] gbuf;
+    if(pbuf)
+        delete[] pbuf;
+
+    gbuf = ng;
+    pbuf = np;
+    bufsize = size;
+
+    if(unread)
+        setg(gbuf, gbuf, gbuf + unread);
+    else
+        setg(gbuf, gbuf + size, gbuf + size);
+    setp(pbuf, pbuf + size);
+    pbump((int)pending);
+
+    Socket::sendsize(so, (unsigned)size);
+    Socket::recvsize(so, (unsigned)size);
+    bulk = true;
+}
+
 int tcpstream::underflow(void)
 {
     ssize_t rlen = 1;
@@ -285,6 +469,62 @@ int tcpstream::overflow(int c)
     return c;
 }
 
+ssize_t tcpstream::_sendfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    return Socket::sendfile(so, file, offset, size);
+}
+
+ssize_t tcpstream::_copyfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    char buffer[16384];
+    size_t total = 0, len, pos;
+    ssize_t result;
+
+    if(file.seek(offset))
+        return -1;
+
+    while(total < size) {
+        len = size - total;
+        if(len > sizeof(buffer))
+            len = sizeof(buffer);
+        result = file.read(buffer, len);
+        if(result < 1)
+            break;
+        len = (size_t)result;
+        pos = 0;
+        while(pos < len) {
+            result = _write(buffer + pos, len - pos);
+            if(result < 1)
+                return total ? (ssize_t)total : -1;
+            pos += result;
+            total += result;
+        }
+    }
+    return (ssize_t)total;
+}
+
+size_t tcpstream::sendfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    ssize_t pending;
+
+    if(so == INVALID_SOCKET || !bufsize)
+        return 0;
+
+    // flush pending output so file follows it in order
+    while(pbase() && (pending = (ssize_t)(pptr() - pbase())) > 0) {
+        overflow(EOF);
+        if(!pbase() || pptr() - pbase() >= pending)
+            return 0;
+    }
+
+    ssize_t result = _sendfile(file, offset, size);
+    if(result < 0) {
+        clear(ios::failbit | rdstate());
+        return 0;
+    }
+    return (size_t)result;
+}
+
 void tcpstream::open(Socket::address& list, unsigned mss)
 {
     if(bufsize)
@@ -399,6 +639,7 @@ void tcpstream::allocate(unsigned mss)
         Socket::sendwait(so, mss * 4);
 
 allocate:
+    bulk = false;
     StreamBuffer::allocate(size);
 }
 
@@ -617,29 +858,69 @@ int pipestream::close(void)
     return -1;
 }
 
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+// size of a mapped filestream window; larger files slide the window
+static const size_t mapped_window = (sizeof(void *) > 4) ? (size_t)1 << 30 : (size_t)1 << 26;
+#endif
+
 filestream::filestream() :
 StreamBuffer()
 {
+    map = NULL;
+    maplen = 0;
+    mapbase = mapsize = 0;
+    mapped = false;
+    aio = NULL;
+    wreq = NULL;
+    wbuf = NULL;
+    wlen = 0;
 }
 
 filestream::filestream(const filestream& copy) :
 StreamBuffer()
 {
+    map = NULL;
+    maplen = 0;
+    mapbase = mapsize = 0;
+    mapped = false;
+    aio = NULL;
+    wreq = NULL;
+    wbuf = NULL;
+    wlen = 0;
+
     if(copy.bufsize)
         fd = copy.fd;
-    if(is(fd))
+    if(is(fd) && copy.ac == fsys::MAPPED)
+        mapping(copy.bufsize);
+    else if(is(fd))
         allocate(copy.bufsize, copy.ac);
 }
 
 filestream::filestream(const char *filename, fsys::access_t mode, size_t size) :
 StreamBuffer()
 {
+    map = NULL;
+    maplen = 0;
+    mapbase = mapsize = 0;
+    mapped = false;
+    aio = NULL;
+    wreq = NULL;
+    wbuf = NULL;
+    wlen = 0;
     open(filename, mode, size);
 }
 
 filestream::filestream(const char *filename, unsigned mode, fsys::access_t access, size_t size) :
 StreamBuffer()
 {
+    map = NULL;
+    maplen = 0;
+    mapbase = mapsize = 0;
+    mapped = false;
+    aio = NULL;
+    wreq = NULL;
+    wbuf = NULL;
+    wlen = 0;
     open(filename, mode, access, size);
 }
 
@@ -648,8 +929,72 @@ filestream::~filestream()
     close();
 }
 
+int filestream::sync(void)
+{
+    if(mapped)
+        return 0;
+
+    int result = StreamBuffer::sync();
+    if(aio && !drain())
+        return -1;
+
+    return result;
+}
+
+void filestream::writeback(AsyncIO *engine)
+{
+    sync();
+
+    if(wreq) {
+        delete wreq;
+        wreq = NULL;
+    }
+
+    if(wbuf) {
+        delete[] wbuf;
+        wbuf = NULL;
+    }
+
+    aio = NULL;
+    wlen = 0;
+
+    if(!engine || !pbuf)
+        return;
+
+    aio = engine;
+    wreq = new AsyncIO::request();
+    wbuf = new char[bufsize];
+}
+
+bool filestream::drain(void)
+{
+    if(!wlen)
+        return true;
+
+    ssize_t result = aio->wait(wreq);
+    size_t size = wlen;
+
+    wlen = 0;
+    if(result < 0)
+        return false;
+
+    // finish a short background write here...
+    while((size_t)result < size) {
+        ssize_t rlen = fd.write(wbuf + result, size - (size_t)result);
+        if(rlen < 1)
+            return false;
+        result += rlen;
+    }
+    return true;
+}
+
 void filestream::seek(fsys::offset_t offset)
 {
+    if(mapped) {
+        remap(offset);
+        return;
+    }
+
     if(bufsize) {
         sync();
         fd.seek(offset);
@@ -658,6 +1003,11 @@ void filestream::seek(fsys::offset_t offset)
 
 void filestream::rewind(void)
 {
+    if(mapped) {
+        remap(0);
+        return;
+    }
+
     sync();
     if(bufsize) {
         fd.seek(0);
@@ -667,6 +1017,9 @@ void filestream::rewind(void)
 void filestream::close(void)
 {
     sync();
+    writeback(NULL);
+    unmap();
+    mapped = false;
 
     if(bufsize)
         fd.close();
@@ -674,6 +1027,72 @@ void filestream::close(void)
     StreamBuffer::release();
 }
 
+void filestream::unmap(void)
+{
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+    if(map)
+        munmap(map, maplen);
+#endif
+    map = NULL;
+    maplen = 0;
+    setg(NULL, NULL, NULL);
+}
+
+bool filestream::remap(fsys::offset_t offset)
+{
+    unmap();
+
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+    if(offset < 0 || offset >= mapsize) {
+        mapbase = mapsize;
+        return false;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    mapbase = offset - (offset % page);
+    maplen = mapped_window;
+    if((fsys::offset_t)maplen > mapsize - mapbase)
+        maplen = (size_t)(mapsize - mapbase);
+
+    caddr_t addr = (caddr_t)mmap(NULL, maplen, PROT_READ, MAP_SHARED, *fd, mapbase);
+    if(addr == (caddr_t)MAP_FAILED) {
+        maplen = 0;
+        return false;
+    }
+
+#ifdef  MADV_SEQUENTIAL
+    madvise(addr, maplen, MADV_SEQUENTIAL);
+#endif
+    map = addr;
+    setg(map, map + (size_t)(offset - mapbase), map + maplen);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void filestream::mapping(size_t size)
+{
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+    struct stat ino;
+
+    if(!fstat(*fd, &ino) && S_ISREG(ino.st_mode)) {
+        ac = fsys::MAPPED;
+        bufsize = (size > 1) ? size : 1;
+        mapsize = ino.st_size;
+        mapped = true;
+        clear();
+        if(!mapsize || remap(0))
+            return;
+        mapped = false;
+        bufsize = 0;
+    }
+#endif
+
+    // not a regular file or cannot map, so use buffered reads...
+    allocate(size, fsys::MAPPED);
+}
+
 void filestream::allocate(size_t size, fsys::access_t mode)
 {
     if(gbuf)
@@ -691,6 +1110,7 @@ void filestream::allocate(size_t size, fsys::access_t mode)
     }
 
     switch (mode) {
+    case fsys::MAPPED:
     case fsys::RDONLY:
     case fsys::RDWR:
     case fsys::SHARED:
@@ -712,6 +1132,7 @@ void filestream::allocate(size_t size, fsys::access_t mode)
     bufsize = size;
     clear();
     switch (mode) {
+    case fsys::MAPPED:
     case fsys::RDONLY:
     case fsys::RDWR:
     case fsys::SHARED:
@@ -738,7 +1159,9 @@ void filestream::open(const char *fname, unsigned fmode, fsys::access_t access,
 {
     close();
     fd.open(fname, fmode, access);
-    if(is(fd))
+    if(is(fd) && access == fsys::MAPPED)
+        mapping(size);
+    else if(is(fd))
         allocate(size, access);
 }
 
@@ -746,7 +1169,9 @@ void filestream::open(const char *fname, fsys::access_t access, size_t size)
 {
     close();
     fd.open(fname, access);
-    if(is(fd))
+    if(is(fd) && access == fsys::MAPPED)
+        mapping(size);
+    else if(is(fd))
         allocate(size, access);
 }
 
@@ -754,6 +1179,18 @@ int filestream::underflow(void)
 {
     ssize_t rlen = 1;
 
+    if(mapped) {
+        if(gptr() && gptr() < egptr())
+            return GET(*gptr());
+
+        // slide mapping to next window of the file...
+        if(!remap(mapbase + (fsys::offset_t)maplen) || gptr() >= egptr()) {
+            clear(ios::failbit | rdstate());
+            return EOF;
+        }
+        return GET(*gptr());
+    }
+
     if(!gbuf)
         return EOF;
 
@@ -780,7 +1217,7 @@ int filestream::underflow(void)
 
 int filestream::overflow(int c)
 {
-    ssize_t rlen, req;
+    ssize_t rlen = 0, req;
 
     if(!pbuf)
         return EOF;
@@ -789,7 +1226,34 @@ int filestream::overflow(int c)
         return EOF;
 
     req = (ssize_t)(pptr() - pbase());
-    if(req) {
+    if(req && aio) {
+        // wait for the prior write, then write this buffer behind
+        if(!drain())
+            return EOF;
+
+        char *prior = pbuf;
+        pbuf = wbuf;
+        wbuf = prior;
+        wlen = (size_t)req;
+        if(aio->write(wreq, fd, wbuf, wlen))
+            aio->submit();
+        else {
+            // not staged, so write it here instead...
+            wlen = 0;
+            while(rlen < req) {
+                ssize_t result = fd.write(wbuf + rlen, req - rlen);
+                if(result < 1) {
+                    if(result < 0)
+                        close();
+                    return EOF;
+                }
+                rlen += result;
+            }
+            rlen = 0;
+        }
+        req = 0;
+    }
+    else if(req) {
         rlen = fd.write(pbase(), req);
         if(rlen < 1) {
             if(rlen < 0)
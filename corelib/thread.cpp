@@ -22,6 +22,7 @@
 #include <ucommon/thread.h>
 #include <ucommon/timers.h>
 #include <ucommon/linked.h>
+#include <ucommon/atomic.h>
 #include <errno.h>
 #include <string.h>
 #include <stdarg.h>
@@ -62,36 +63,66 @@ class __LOCAL mutex_index : public Mutex
 {
 public:
     struct mutex_entry *list;
+    Atomic::counter contention;
 
     mutex_index();
+
+    void enter(void);
 };
 
 class __LOCAL rwlock_index : public Mutex
 {
 public:
     rwlock_entry *list;
+    Atomic::counter contention;
 
     rwlock_index();
+
+    void enter(void);
 };
 
+// guard protection tables are striped over cache line padded indexes so
+// that stripe locks held by different cpus do not share a cache line.
+typedef struct {
+    void *base;
+    size_t stride;
+    unsigned size;
+} stripes_t;
+
 static rwlock_index single_rwlock;
-static rwlock_index *rwlock_table = &single_rwlock;
+static stripes_t rwlock_single = {&single_rwlock, sizeof(rwlock_index), 1};
+static stripes_t *volatile rwlock_table = &rwlock_single;
 static mutex_index single_table;
-static mutex_index *mutex_table = &single_table;
-static unsigned mutex_indexing = 1;
-static unsigned rwlock_indexing = 1;
+static stripes_t mutex_single = {&single_table, sizeof(mutex_index), 1};
+static stripes_t *volatile mutex_table = &mutex_single;
 static pthread_key_t threadmap;
 
-mutex_index::mutex_index() : Mutex()
+mutex_index::mutex_index() : Mutex(), contention(0)
 {
     list = NULL;
 }
 
-rwlock_index::rwlock_index() : Mutex()
+void mutex_index::enter(void)
+{
+    if(pthread_mutex_trylock(&mlock)) {
+        ++contention;
+        pthread_mutex_lock(&mlock);
+    }
+}
+
+rwlock_index::rwlock_index() : Mutex(), contention(0)
 {
     list = NULL;
 }
 
+void rwlock_index::enter(void)
+{
+    if(pthread_mutex_trylock(&mlock)) {
+        ++contention;
+        pthread_mutex_lock(&mlock);
+    }
+}
+
 rwlock_entry::rwlock_entry() : RWLock()
 {
     count = 0;
@@ -101,23 +132,135 @@ static unsigned hash_address(const void *ptr, unsigned indexing)
 {
     assert(ptr != NULL);
 
-    unsigned key = 0;
-    unsigned count = 0;
-    const unsigned char *addr = (unsigned char *)(&ptr);
-
     if(indexing < 2)
         return 0;
 
-    // skip lead zeros if little endian...
-    while(count < sizeof(const void *) && *addr == 0) {
-        ++count;
-        ++addr;
+    // mix all address bits, since low bits of aligned objects are constant
+    uint64_t key = (uint64_t)((uintptr_t)ptr);
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+
+    return (unsigned)(key % indexing);
+}
+
+// a new table is published with release semantics, so a reader that
+// sees the pointer also sees the constructed stripes it points to.
+static inline stripes_t *stripe_table(stripes_t *volatile *table)
+{
+#if defined(__GNUC__)
+    return __atomic_load_n(table, __ATOMIC_ACQUIRE);
+#else
+    return *table;
+#endif
+}
+
+static inline void stripe_publish(stripes_t *volatile *table, stripes_t *update)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(table, update, __ATOMIC_RELEASE);
+#else
+    *table = update;
+#endif
+}
+
+template<class T>
+static inline T *stripe(const stripes_t *table, unsigned pos)
+{
+    return reinterpret_cast<T *>((caddr_t)table->base + table->stride * pos);
+}
+
+// lock the stripe of an object, retrying if the table was resized while
+// we waited for the stripe lock.
+template<class T>
+static T *stripe(stripes_t *volatile *table, const void *ptr)
+{
+    for(;;) {
+        stripes_t *current = stripe_table(table);
+        T *index = stripe<T>(current, hash_address(ptr, current->size));
+        index->enter();
+        if(current == stripe_table(table))
+            return index;
+        index->release();
+    }
+}
+
+// size default guard tables from the cpu count when the first thread is
+// started, unless the application already set them with indexing().
+static void stripe_default(void)
+{
+    if(stripe_table(&mutex_table)->size < 2)
+        Mutex::indexing(0);
+    if(stripe_table(&rwlock_table)->size < 2)
+        RWLock::indexing(0);
+}
+
+template<class E>
+static bool stripe_busy(const E *entry)
+{
+    while(entry) {
+        if(entry->count)
+            return true;
+        entry = entry->next;
     }
+    return false;
+}
+
+static unsigned stripe_count(unsigned size)
+{
+    unsigned count = 8;
 
-    while(count++ < sizeof(const void *) && *addr)
-        key = (key << 1) ^ *(addr++);
+    if(!size)
+        size = Thread::cpus() * 4;
 
-    return key % indexing;
+    while(count < size && count < 1024)
+        count <<= 1;
+
+    return count;
+}
+
+// tables may only be replaced while no guarded objects are held, since
+// entries are found through the stripe they were hashed to.  The old
+// table is left in place for threads still spinning on its stripes.
+template<class T>
+static void stripe_resize(stripes_t *volatile *table, unsigned size)
+{
+    stripes_t *current = stripe_table(table);
+    unsigned pos = 0;
+    bool busy = false;
+
+    if(size < 2 || size == current->size)
+        return;
+
+    while(pos < current->size) {
+        T *index = stripe<T>(current, pos++);
+        index->enter();
+        if(stripe_busy(index->list))
+            busy = true;
+    }
+
+    if(!busy && current == stripe_table(table)) {
+        size_t line = Thread::cache();
+        if(line < sizeof(void *))
+            line = sizeof(void *);
+
+        stripes_t *update = new stripes_t;
+        update->size = size;
+        update->stride = ((sizeof(T) + line - 1) / line) * line;
+        caddr_t mem = (caddr_t)::malloc(update->stride * size + line);
+        if(!mem)
+            __THROW_ALLOC();
+        mem += (line - ((uintptr_t)mem % line)) % line;
+        update->base = mem;
+        for(unsigned member = 0; member < size; ++member)
+            new(stripe<T>(update, member)) T;
+        stripe_publish(table, update);
+    }
+
+    while(pos)
+        stripe<T>(current, --pos)->release();
 }
 
 ReusableAllocator::ReusableAllocator() :
@@ -463,18 +606,44 @@ Mutex::~Mutex()
 
 void Mutex::indexing(unsigned index)
 {
-    if(index > 1) {
-        mutex_table = new mutex_index[index];
-        mutex_indexing = index;
-    }
+    if(index != 1)
+        stripe_resize<mutex_index>(&mutex_table, stripe_count(index));
+}
+
+unsigned Mutex::stripes(void)
+{
+    return stripe_table(&mutex_table)->size;
+}
+
+unsigned Mutex::contention(unsigned index)
+{
+    stripes_t *current = stripe_table(&mutex_table);
+
+    if(index >= current->size)
+        return 0;
+
+    return (unsigned)stripe<mutex_index>(current, index)->contention.get();
 }
 
 void RWLock::indexing(unsigned index)
 {
-    if(index > 1) {
-        rwlock_table = new rwlock_index[index];
-        rwlock_indexing = index;
-    }
+    if(index != 1)
+        stripe_resize<rwlock_index>(&rwlock_table, stripe_count(index));
+}
+
+unsigned RWLock::stripes(void)
+{
+    return stripe_table(&rwlock_table)->size;
+}
+
+unsigned RWLock::contention(unsigned index)
+{
+    stripes_t *current = stripe_table(&rwlock_table);
+
+    if(index >= current->size)
+        return 0;
+
+    return (unsigned)stripe<rwlock_index>(current, index)->contention.get();
 }
 
 RWLock::reader::reader()
@@ -549,13 +718,13 @@ void RWLock::writer::release(void)
 
 bool RWLock::reader::lock(const void *ptr, timeout_t timeout)
 {
-    rwlock_index *index = &rwlock_table[hash_address(ptr, rwlock_indexing)];
+    rwlock_index *index;
     rwlock_entry *entry, *empty = NULL;
 
     if(!ptr)
         return false;
 
-    index->acquire();
+    index = stripe<rwlock_index>(&rwlock_table, ptr);
     entry = index->list;
     while(entry) {
         if(entry->count && entry->object == ptr)
@@ -576,7 +745,10 @@ bool RWLock::reader::lock(const void *ptr, timeout_t timeout)
     entry->object = ptr;
     ++entry->count;
     index->release();
-    if(entry->access(timeout))
+    if(entry->access(0))
+        return true;
+    ++index->contention;
+    if(timeout && entry->access(timeout))
         return true;
     index->acquire();
     --entry->count;
@@ -586,13 +758,13 @@ bool RWLock::reader::lock(const void *ptr, timeout_t timeout)
 
 bool RWLock::writer::lock(const void *ptr, timeout_t timeout)
 {
-    rwlock_index *index = &rwlock_table[hash_address(ptr, rwlock_indexing)];
+    rwlock_index *index;
     rwlock_entry *entry, *empty = NULL;
 
     if(!ptr)
         return false;
 
-    index->acquire();
+    index = stripe<rwlock_index>(&rwlock_table, ptr);
     entry = index->list;
     while(entry) {
         if(entry->count && entry->object == ptr)
@@ -613,7 +785,10 @@ bool RWLock::writer::lock(const void *ptr, timeout_t timeout)
     entry->object = ptr;
     ++entry->count;
     index->release();
-    if(entry->modify(timeout))
+    if(entry->modify(0))
+        return true;
+    ++index->contention;
+    if(timeout && entry->modify(timeout))
         return true;
     index->acquire();
     --entry->count;
@@ -643,13 +818,13 @@ void RWLock::_unshare(void)
 
 bool Mutex::protect(const void *ptr)
 {
-    mutex_index *index = &mutex_table[hash_address(ptr, mutex_indexing)];
+    mutex_index *index;
     mutex_entry *entry, *empty = NULL;
 
     if(!ptr)
         return false;
 
-    index->acquire();
+    index = stripe<mutex_index>(&mutex_table, ptr);
     entry = index->list;
     while(entry) {
         if(entry->count && entry->pointer == ptr)
@@ -673,19 +848,22 @@ bool Mutex::protect(const void *ptr)
     ++entry->count;
 //  printf("ACQUIRE %p, THREAD %d, POINTER %p, COUNT %d\n", entry, Thread::self(), entry->pointer, entry->count);
     index->release();
-    pthread_mutex_lock(&entry->mutex);
+    if(pthread_mutex_trylock(&entry->mutex)) {
+        ++index->contention;
+        pthread_mutex_lock(&entry->mutex);
+    }
 	return true;
 }
 
 bool RWLock::release(const void *ptr)
 {
-    rwlock_index *index = &rwlock_table[hash_address(ptr, rwlock_indexing)];
+    rwlock_index *index;
     rwlock_entry *entry;
 
     if(!ptr)
         return false;
 
-    index->acquire();
+    index = stripe<rwlock_index>(&rwlock_table, ptr);
     entry = index->list;
     while(entry) {
         if(entry->count && entry->object == ptr)
@@ -705,13 +883,13 @@ bool RWLock::release(const void *ptr)
 
 bool Mutex::release(const void *ptr)
 {
-    mutex_index *index = &mutex_table[hash_address(ptr, mutex_indexing)];
+    mutex_index *index;
     mutex_entry *entry;
 
     if(!ptr)
         return false;
 
-    index->acquire();
+    index = stripe<mutex_index>(&mutex_table, ptr);
     entry = index->list;
     while(entry) {
         if(entry->count && entry->pointer == ptr)
@@ -1117,6 +1295,7 @@ void JoinableThread::start(int adj)
     if(running != INVALID_HANDLE_VALUE)
         return;
 
+    stripe_default();
     priority = adj;
 
     if(stack == 1)
@@ -1132,6 +1311,7 @@ void DetachedThread::start(int adj)
 {
     HANDLE hThread;;
 
+    stripe_default();
     priority = adj;
 
     if(stack == 1)
@@ -1176,6 +1356,7 @@ void JoinableThread::start(int adj)
     if(running)
         return;
 
+    stripe_default();
     joining = false;
     priority = adj;
 
@@ -1203,6 +1384,7 @@ void JoinableThread::start(int adj)
 
 void DetachedThread::start(int adj)
 {
+    stripe_default();
     priority = adj;
     pthread_attr_t attr;
     pthread_attr_init(&attr);
@@ -1336,6 +1518,27 @@ size_t Thread::cache(void)
 #endif
 }
 
+unsigned Thread::cpus(void)
+{
+    static volatile unsigned count = 0;
+
+    if(count)
+        return count;
+
+#if defined(_MSWINDOWS_)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (unsigned)info.dwNumberOfProcessors;
+#elif defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if(online > 0)
+        count = (unsigned)online;
+#endif
+    if(!count)
+        count = 1;
+    return count;
+}
+
 pthread_t Thread::self(void)
 {
     return pthread_self();
@@ -52,12 +52,23 @@ void TypeRef::Counted::operator delete(void *addr)
 
 void TypeRef::Counted::retain(void)
 {
-    count.fetch_retain();
+    // confined containers are only ever counted by their own thread
+    if(autorelease == &local_release)
+        count.fetch_local(1);
+    else
+        count.fetch_retain();
 }
 
 void TypeRef::Counted::release(void)
 {
-    if(count.fetch_release() < 2) {
+    atomic_t prior;
+
+    if(autorelease == &local_release)
+        prior = count.fetch_local(-1);
+    else
+        prior = count.fetch_release();
+
+    if(prior < 2) {
 	    dealloc();
     }
 }
@@ -122,6 +133,16 @@ void TypeRef::assign(const typeref_guard& global)
     global.sync.release();
 }
 
+void TypeRef::assign(const typeref_epoch& global)
+{
+    typeref_epoch::reader epoch;
+    Counted *object = *((Counted * const volatile *)&global.ref);
+    if(object)
+        object->retain();
+    clear();
+    ref = object;
+}
+
 void TypeRef::set(TypeRef::Counted *object)
 {
     if(object)
@@ -145,6 +166,224 @@ void typeref_guard::set(const TypeRef& pointer)
     sync.unlock();
 }
 
+// Reader epochs are kept in per-thread slots, each on its own cache line.
+// A slot holds the global epoch a thread entered at, or 0 when the thread
+// is not reading.  Slots are reused once their thread exits.
+
+class __LOCAL epoch_slot
+{
+public:
+    epoch_slot *next;
+    Atomic::counter epoch;
+    unsigned depth;
+    bool used;
+};
+
+class __LOCAL epoch_retired
+{
+public:
+    epoch_retired *next;
+    TypeRef::Counted *object;
+    atomic_t epoch;
+};
+
+class __LOCAL epoch_domain
+{
+public:
+    Mutex lock;
+    Atomic::counter epoch;
+    epoch_slot *slots;
+    epoch_retired *retired;
+    pthread_key_t key;
+
+    epoch_domain() : epoch(1) {
+        slots = NULL;
+        retired = NULL;
+#ifdef  _MSTHREADS_
+        key = TlsAlloc();
+#else
+        pthread_key_create(&key, &exit);
+#endif
+    }
+
+    epoch_slot *get(void);
+
+    atomic_t advance(void);
+
+    unsigned reclaim(void);
+
+    static void exit(void *slot);
+};
+
+static epoch_domain epochs;
+
+epoch_slot *epoch_domain::get(void)
+{
+#ifdef  _MSTHREADS_
+    epoch_slot *slot = (epoch_slot *)TlsGetValue(key);
+#else
+    epoch_slot *slot = (epoch_slot *)pthread_getspecific(key);
+#endif
+    if(slot)
+        return slot;
+
+    lock.acquire();
+    slot = slots;
+    while(slot && slot->used)
+        slot = slot->next;
+
+    if(!slot) {
+        size_t line = Thread::cache();
+        caddr_t mem = (caddr_t)::malloc(line * 2);
+        caddr_t addr = mem + line - ((uintptr_t)mem % line);
+        slot = new(addr) epoch_slot;
+        slot->next = slots;
+        slots = slot;
+    }
+    slot->depth = 0;
+    slot->used = true;
+    lock.release();
+#ifdef  _MSTHREADS_
+    TlsSetValue(key, slot);
+#else
+    pthread_setspecific(key, slot);
+#endif
+    return slot;
+}
+
+void epoch_domain::exit(void *addr)
+{
+    epoch_slot *slot = (epoch_slot *)addr;
+    epochs.lock.acquire();
+    slot->used = false;
+    epochs.lock.release();
+}
+
+atomic_t epoch_domain::advance(void)
+{
+    atomic_t current = epoch.get();
+    atomic_t next;
+
+    // epoch 0 is reserved for idle slots
+    do {
+        next = (atomic_t)((unsigned)current + 1);
+        if(!next)
+            next = 1;
+    } while(!epoch.compare_exchange(current, next));
+    return current;
+}
+
+unsigned epoch_domain::reclaim(void)
+{
+    epoch_retired *list, *keep = NULL, *node;
+    unsigned count = 0;
+    bool active = false;
+    atomic_t oldest = 0;
+
+    lock.acquire();
+    list = retired;
+    retired = NULL;
+    for(epoch_slot *slot = slots; slot; slot = slot->next) {
+        // compare as a full barrier against readers entering
+        atomic_t current = 0;
+        slot->epoch.compare_exchange(current, 0);
+        if(!current)
+            continue;
+        if(!active || (atomic_t)((unsigned)current - (unsigned)oldest) < 0)
+            oldest = current;
+        active = true;
+    }
+
+    while(list) {
+        node = list;
+        list = list->next;
+        // readers at the retiring epoch or earlier may still see it
+        if(active && (atomic_t)((unsigned)oldest - (unsigned)node->epoch) <= 0) {
+            node->next = keep;
+            keep = node;
+            continue;
+        }
+        node->object->release();
+        delete node;
+        ++count;
+    }
+
+    while(keep) {
+        node = keep;
+        keep = keep->next;
+        node->next = retired;
+        retired = node;
+    }
+    lock.release();
+    return count;
+}
+
+typeref_epoch::reader::reader()
+{
+    epoch_slot *current = epochs.get();
+    slot = current;
+    if(current->depth++)
+        return;
+
+    // full barrier, so the published pointer is read after we are visible
+    atomic_t idle = 0;
+    current->epoch.compare_exchange(idle, epochs.epoch.get());
+}
+
+typeref_epoch::reader::~reader()
+{
+    epoch_slot *current = (epoch_slot *)slot;
+    if(--current->depth)
+        return;
+
+    atomic_t entered = current->epoch.get();
+    current->epoch.compare_exchange(entered, 0);
+}
+
+typeref_epoch::typeref_epoch() :
+TypeRef()
+{
+}
+
+typeref_epoch::typeref_epoch(const TypeRef& pointer) :
+TypeRef(pointer)
+{
+}
+
+typeref_epoch::~typeref_epoch()
+{
+    epochs.reclaim();
+}
+
+void typeref_epoch::set(const TypeRef& pointer)
+{
+    Counted *prior;
+
+    if(pointer.ref)
+        pointer.ref->retain();
+
+    sync.lock();
+    prior = ref;
+    *((Counted * volatile *)&ref) = pointer.ref;
+    sync.unlock();
+
+    if(prior) {
+        epoch_retired *node = new epoch_retired;
+        node->object = prior;
+        epochs.lock.acquire();
+        node->epoch = epochs.advance();
+        node->next = epochs.retired;
+        epochs.retired = node;
+        epochs.lock.release();
+    }
+    epochs.reclaim();
+}
+
+unsigned typeref_epoch::reclaim(void)
+{
+    return epochs.reclaim();
+}
+
 typeref<const char *>::value::value(caddr_t addr, size_t objsize, const char *str, TypeRelease *ar) : 
 TypeRef::Counted(addr, objsize, ar)
 {
@@ -653,6 +892,9 @@ size_t typeref<const uint8_t *>::set(bool mode, size_t offset, size_t bits)
 
 caddr_t TypeRelease::allocate(size_t size)
 {
+    if(delegate)
+        return delegate->allocate(size);
+
     return (caddr_t)::malloc(size + Thread::cache());
 }
 
@@ -752,11 +994,210 @@ void TypeSecure::release(TypeRef::Counted *obj)
     TypeRelease::release(obj);
 }
 
+// Pooled blocks are whole cache lines carved from larger chunks, and are
+// recycled through per-thread free lists kept by the number of lines in a
+// block.  Since a pooled block is already aligned, allocate() returns an
+// address that many bytes below it.  mem() then places the container at
+// the block itself, and the container offset records the block size.
+// Larger blocks come from the heap with the container at offset 0.
+
+#define POOL_CLASSES    8       // largest pooled block in cache lines
+#define POOL_BATCH      32      // blocks moved to or from shared lists
+#define POOL_CHUNK      16384   // bytes carved into new blocks
+
+class TypePool;
+
+class __LOCAL pool_cache
+{
+public:
+    TypePool *pool;
+    caddr_t free[POOL_CLASSES];
+    unsigned count[POOL_CLASSES];
+};
+
+class __LOCAL TypePool __FINAL : public TypeRelease
+{
+private:
+    Mutex lock;
+    caddr_t shared[POOL_CLASSES];
+    caddr_t chunk;
+    size_t remains;
+    pthread_key_t key;
+
+    pool_cache *get(void);
+
+    void refill(pool_cache *cache, unsigned id, size_t size);
+
+    void spill(pool_cache *cache, unsigned id, unsigned count);
+
+    void release(TypeRef::Counted *obj) __FINAL;
+
+    static void exit(void *cache);
+
+public:
+    TypePool();
+
+    caddr_t allocate(size_t size) __FINAL;
+};
+
+TypePool::TypePool()
+{
+    memset(shared, 0, sizeof(shared));
+    chunk = NULL;
+    remains = 0;
+#ifdef  _MSTHREADS_
+    key = TlsAlloc();
+#else
+    pthread_key_create(&key, &exit);
+#endif
+}
+
+pool_cache *TypePool::get(void)
+{
+#ifdef  _MSTHREADS_
+    pool_cache *cache = (pool_cache *)TlsGetValue(key);
+#else
+    pool_cache *cache = (pool_cache *)pthread_getspecific(key);
+#endif
+    if(cache)
+        return cache;
+
+    cache = new pool_cache;
+    memset(cache, 0, sizeof(pool_cache));
+    cache->pool = this;
+#ifdef  _MSTHREADS_
+    TlsSetValue(key, cache);
+#else
+    pthread_setspecific(key, cache);
+#endif
+    return cache;
+}
+
+void TypePool::exit(void *addr)
+{
+    pool_cache *cache = (pool_cache *)addr;
+
+    for(unsigned id = 0; id < POOL_CLASSES; ++id)
+        cache->pool->spill(cache, id, cache->count[id]);
+    delete cache;
+}
+
+void TypePool::refill(pool_cache *cache, unsigned id, size_t size)
+{
+    caddr_t block;
+    unsigned count = 0;
+
+    lock.acquire();
+    while(shared[id] && count < POOL_BATCH) {
+        block = shared[id];
+        shared[id] = *((caddr_t *)block);
+        *((caddr_t *)block) = cache->free[id];
+        cache->free[id] = block;
+        ++count;
+    }
+
+    while(count < POOL_BATCH) {
+        if(remains < size) {
+            size_t line = Thread::cache();
+            caddr_t mem = (caddr_t)::malloc(POOL_CHUNK + line);
+            if(!mem) {
+                lock.release();
+                cache->count[id] += count;
+                __THROW_ALLOC();
+                return;
+            }
+            chunk = mem + (line - ((uintptr_t)mem % line)) % line;
+            remains = POOL_CHUNK;
+        }
+        block = chunk;
+        chunk += size;
+        remains -= size;
+        *((caddr_t *)block) = cache->free[id];
+        cache->free[id] = block;
+        ++count;
+    }
+    lock.release();
+    cache->count[id] += count;
+}
+
+void TypePool::spill(pool_cache *cache, unsigned id, unsigned count)
+{
+    caddr_t block;
+
+    lock.acquire();
+    while(count-- && cache->free[id]) {
+        block = cache->free[id];
+        cache->free[id] = *((caddr_t *)block);
+        *((caddr_t *)block) = shared[id];
+        shared[id] = block;
+        --cache->count[id];
+    }
+    lock.release();
+}
+
+caddr_t TypePool::allocate(size_t size)
+{
+    size_t line = Thread::cache();
+    unsigned lines = (unsigned)((size + line - 1) / line);
+
+    if(lines > POOL_CLASSES) {
+        // the heap address is kept in front of the aligned block
+        caddr_t mem = (caddr_t)::malloc(size + line + sizeof(caddr_t));
+        if(!mem) {
+            __THROW_ALLOC();
+            return NULL;
+        }
+        caddr_t addr = mem + sizeof(caddr_t);
+        addr += (line - ((uintptr_t)addr % line)) % line;
+        ((caddr_t *)addr)[-1] = mem;
+        return addr;
+    }
+
+    if(!lines)
+        lines = 1;
+
+    unsigned id = lines - 1;
+    pool_cache *cache = get();
+    if(!cache->free[id])
+        refill(cache, id, line * lines);
+
+    caddr_t block = cache->free[id];
+    cache->free[id] = *((caddr_t *)block);
+    --cache->count[id];
+    return block - lines;
+}
+
+void TypePool::release(TypeRef::Counted *obj)
+{
+    unsigned lines = offset(obj);
+    caddr_t block = (caddr_t)obj;
+
+    // runs the destructor only, the container delete operator is empty
+    delete obj;
+
+    if(!lines) {
+        ::free(((caddr_t *)block)[-1]);
+        return;
+    }
+
+    unsigned id = lines - 1;
+    pool_cache *cache = get();
+    *((caddr_t *)block) = cache->free[id];
+    cache->free[id] = block;
+
+    // pass surplus blocks on, such as from a thread that only releases
+    if(++cache->count[id] > POOL_BATCH * 2)
+        spill(cache, id, POOL_BATCH);
+}
+
 static TypeSecure _secure_release;
 static TypeReleaseLater _release_later;
+static TypePool _pooled_release;
 
 TypeRelease auto_release;
 TypeRelease secure_release(&_secure_release);
 TypeRelease release_later(&_release_later);
+TypeRelease pooled_release(&_pooled_release);
+TypeRelease local_release(&_pooled_release);
 
 } // namespace
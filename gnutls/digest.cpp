@@ -136,6 +136,30 @@ buffer[count]);
     bufsize = 0;
 }
 
+unsigned Digest::batch(const char *type, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **digests)
+{
+    MD_CTX ctx;
+    size_t pos;
+
+    secure::init();
+
+    MD_ID id = (MD_ID)__context::map_digest(type);
+    if(!id || gnutls_hash_get_len(id) < 1)
+        return 0;
+
+    if(gnutls_hash_init(&ctx, id) < 0)
+        return 0;
+
+    // output also resets the context for the next message
+    for(pos = 0; pos < count; ++pos) {
+        gnutls_hash(ctx, data[pos], size[pos]);
+        gnutls_hash_output(ctx, digests[pos]);
+    }
+
+    gnutls_hash_deinit(ctx, NULL);
+    return gnutls_hash_get_len(id);
+}
+
 const uint8_t *Digest::get(void)
 {
     unsigned count = 0;
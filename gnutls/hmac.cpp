@@ -88,6 +88,65 @@ void HMAC::set(const char *digest, const secure::keybytes& key)
         gnutls_hmac_init((HMAC_CTX *)&context, id, *key, len);
 }
 
+void HMAC::set(const Key& key)
+{
+    release();
+
+    if(!key.context || !key.keyid)
+        return;
+
+    hmacid = key.keyid;
+
+#if GNUTLS_VERSION_NUMBER >= 0x030609
+    // copy the keyed state if the algorithm supports it
+    context = gnutls_hmac_copy((HMAC_CTX)key.context);
+    if(context)
+        return;
+#endif
+
+    __multicode id;
+    id.code = hmacid;
+
+    if(gnutls_hmac_init((HMAC_CTX *)&context, id, *key.keydata, key.keydata.size() / 8) < 0)
+        context = NULL;
+}
+
+void HMAC::Key::set(const char *digest, const secure::keybytes& key)
+{
+    secure::init();
+
+    clear();
+
+    size_t len = key.size() / 8;
+
+    if(!len)
+        return;
+
+    keyid = __context::map_hmac(digest);
+
+    __multicode id;
+    id.code = keyid;
+
+    if(!keyid || gnutls_hmac_init((HMAC_CTX *)&context, id, *key, len) < 0) {
+        context = NULL;
+        keyid = 0;
+        return;
+    }
+
+    keydata = key;
+}
+
+void HMAC::Key::clear(void)
+{
+    if(context) {
+        gnutls_hmac_deinit((HMAC_CTX)context, NULL);
+        context = NULL;
+    }
+
+    keydata = secure::keybytes();
+    keyid = 0;
+}
+
 bool HMAC::has(const char *type)
 {
     HMAC_ID id = (HMAC_ID)__context::map_hmac(type);
@@ -107,9 +166,34 @@ bool HMAC::put(const void *address, size_t size)
     return true;
 }
 
+unsigned HMAC::batch(const char *digest, const secure::keybytes& key, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **results)
+{
+    HMAC_CTX ctx;
+    size_t pos;
+    size_t len = key.size() / 8;
+    __multicode id;
+
+    secure::init();
+
+    id.code = __context::map_hmac(digest);
+    if(!id.code || !len || gnutls_hmac_get_len(id) < 1)
+        return 0;
+
+    if(gnutls_hmac_init(&ctx, id, *key, len) < 0)
+        return 0;
+
+    // output also resets the context to the keyed state
+    for(pos = 0; pos < count; ++pos) {
+        gnutls_hmac(ctx, data[pos], size[pos]);
+        gnutls_hmac_output(ctx, results[pos]);
+    }
+
+    gnutls_hmac_deinit(ctx, NULL);
+    return gnutls_hmac_get_len(id);
+}
+
 const uint8_t *HMAC::get(void)
 {
-    unsigned count = 0;
     unsigned size = 0;
 
     if(bufsize)
@@ -122,12 +206,6 @@ const uint8_t *HMAC::get(void)
     release();
 
     bufsize = size;
-
-    while(count < bufsize) {
-        snprintf(textbuf + (count * 2), 3, "%2.2x",
-buffer[count]);
-        ++count;
-    }
     return buffer;
 }
 
@@ -281,6 +281,17 @@ class __EXPORT AppLog : protected streambuf, public ostream
      */
     void logFileName(const char* FileName, bool logDirectly = false);
 #endif
+
+    /**
+     * Spool log records through per thread ring buffers.  Each subscribed
+     * thread formats records straight into its own ring without locking
+     * or allocating, and a single spooler thread drains all rings into
+     * the log file with gathered writes.  Only used when not logging
+     * directly and a log file name has been set.
+     * @param size of each thread ring buffer, 0 for default.
+     */
+    void logAsync(size_t size = 0);
+
     /**
      * if logDirectly is set it closes the file.
      */
@@ -867,6 +867,9 @@ public:
     bool isValid(void) __OVERRIDE;
 };
 
+// size classes of pooled queue items
+#define QUEUE_CLASSES   5
+
 /**
  * Somewhat generic queue processing class to establish a producer
  * consumer queue.  This may be used to buffer cdr records, or for
@@ -898,11 +901,17 @@ protected:
 
     timeout_t timeout;
     bool started;
+    bool pooling, coalesce, idle;
 
     data_t *first, *last;       // head/tail of list
+    data_t *pool[QUEUE_CLASSES];    // size classed free lists
+    unsigned pooled[QUEUE_CLASSES];
 
     String name;
 
+    data_t *newData(unsigned len);
+    void freeData(data_t *data);
+
     /*
      * Overloading of final(). It demarks Semaphore to avoid deadlock.
      */
@@ -936,6 +945,17 @@ protected:
      */
     virtual void runQueue(void *data) = 0;
 
+    /**
+     * Virtual callback method to handle a batch of queued data items
+     * when pooling is used.  The default calls runQueue for each item
+     * in order.  A derived class may override this to handle several
+     * items at once.
+     *
+     * @param data items being dequeued.
+     * @param count of items.
+     */
+    virtual void runQueue(void **data, unsigned count);
+
 public:
     /**
      * Create instance of our queue and give it a process priority.
@@ -960,6 +980,17 @@ public:
      */
     void setTimer(timeout_t timeout);
 
+    /**
+     * Use pooled queue items and batched dequeing.  Items are reused
+     * from size classed free lists rather than from the heap, and the
+     * queue thread takes all waiting items at once.  This should be set
+     * before data is posted.
+     *
+     * @param coalesce wakeups, so the queue thread is only signalled
+     * when it is idle.
+     */
+    void setPooling(bool coalesce = true);
+
     /**
      * Put some unspecified data into this queue.  A new qd
      * structure is created and sized to contain a copy of
@@ -68,6 +68,8 @@ protected:
 
 		arraytype_t type;
 
+		volatile bool frozen;
+
 		explicit Array(arraytype_t mode, void *addr, size_t size);
 
 		void assign(size_t index, Counted *object);
@@ -88,6 +90,7 @@ protected:
 	ArrayRef(arraytype_t mode, size_t size);
 	ArrayRef(arraytype_t mode, size_t size, TypeRef& object);
 	ArrayRef(const ArrayRef& copy);
+	ArrayRef(const typeref_epoch& global);
 	ArrayRef();
 
 	void assign(size_t index, TypeRef& t);
@@ -102,6 +105,10 @@ protected:
 
 	static Array *create(arraytype_t type, size_t size);
 
+	void writable(void);
+
+	void publish(typeref_epoch& target);
+
 protected:
 	void push(const TypeRef& object);
 
@@ -259,6 +266,125 @@ public:
 	}
 };
 
+/**
+ * Lockfree bounded queue of typeref objects.  Any number of threads may
+ * push and pull concurrently.  Each slot has a sequence number that tells
+ * producers and consumers when it may be claimed, and the head and tail
+ * are kept on separate cache lines.  Threads only fall back to waiting on
+ * the conditional when the ring is full or empty.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT RingRef : public TypeRef
+{
+protected:
+	class __EXPORT Ring : public Counted, public Conditional
+	{
+	private:
+		__DELETE_DEFAULTS(Ring);
+
+	protected:
+		friend class RingRef;
+
+		typedef struct {
+			Atomic::counter sequence;
+			Counted *object;
+		} slot_t;
+
+		size_t mask;
+		slot_t *slots;
+		Atomic::counter *head, *tail;
+		Atomic::counter waiting;
+
+		explicit Ring(void *addr, size_t size);
+
+		bool put(Counted *object);
+
+		Counted *take(void);
+
+		size_t count(void);
+
+		void enter(void);
+
+		void notify(void);
+
+		virtual void dealloc() __OVERRIDE;
+	};
+
+	RingRef(size_t size);
+	RingRef(const RingRef& copy);
+	RingRef();
+
+	static Ring *create(size_t size);
+
+	bool push(const TypeRef& object, timeout_t timeout = Timer::inf);
+
+	void pull(TypeRef& object, timeout_t timeout = Timer::inf);
+
+public:
+	size_t count(void);
+};
+
+/**
+ * Lockfree bounded queue of typed objects.  The size of the ring is
+ * rounded up to a power of two.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template<typename T>
+class ringref : public RingRef
+{
+public:
+	inline ringref() : RingRef() {};
+
+	inline ringref(const ringref& copy) : RingRef(copy) {};
+
+	inline ringref(size_t size) : RingRef(size) {};
+
+	inline ringref& operator=(const ringref& copy) {
+		TypeRef::set(copy);
+		return *this;
+	}
+
+	inline void release(void) {
+		TypeRef::set(nullptr);
+	}
+
+	inline typeref<T> pull() {
+		typeref<T> obj;
+		RingRef::pull(obj);
+		return obj;
+	}
+
+	inline typeref<T> pull(timeout_t timeout) {
+		typeref<T> obj;
+		RingRef::pull(obj, timeout);
+		return obj;
+	}
+
+	inline ringref& operator>>(typeref<T>& target) {
+		RingRef::pull(target);
+		return *this;
+	}
+
+	inline void push(const typeref<T>& source) {
+		RingRef::push(source);
+	}
+
+	inline bool push(const typeref<T>& source, timeout_t timeout) {
+		return RingRef::push(source, timeout);
+	}
+
+	inline ringref& operator<<(const typeref<T>& source) {
+		RingRef::push(source);
+		return *this;
+	}
+
+	inline ringref& operator<<(T t) {
+		typeref<T> v(t);
+		RingRef::push(v);
+		return *this;
+	}
+};
+
 template<typename T>
 class arrayref : public ArrayRef
 {
@@ -267,6 +393,8 @@ public:
 
 	inline arrayref(const arrayref& copy) : ArrayRef(copy) {};
 
+	inline arrayref(const typeref_epoch& global) : ArrayRef(global) {};
+
 	inline arrayref(size_t size) : ArrayRef(ARRAY, size) {};
 
 	inline arrayref(size_t size, typeref<T>& t) : ArrayRef(ARRAY, size, t) {};
@@ -281,6 +409,11 @@ public:
 		return *this;
 	}
 
+	inline arrayref& operator=(const typeref_epoch& global) {
+		TypeRef::assign(global);
+		return *this;
+	}
+
 	inline arrayref& operator=(typeref<T>& t) {
 		reset(t);
 		return *this;
@@ -327,6 +460,16 @@ public:
 	inline void release(void) {
 		TypeRef::set(nullptr);
 	}
+
+	/**
+	 * Publish the array as a read-only snapshot.  Once published, the
+	 * array is read without locking, and changing it through any
+	 * reference first makes a private copy.
+	 * @param target to publish to.
+	 */
+	inline void publish(typeref_epoch& target) {
+		ArrayRef::publish(target);
+	}
 };
 
 typedef arrayref<Type::Bytes> bytearray_t;
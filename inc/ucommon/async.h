@@ -0,0 +1,243 @@
+// Copyright (C) 2006-2014 David Sugar, Tycho Softworks.
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+/**
+ * Asynchronous file i/o.  This offers an engine that performs fsys reads,
+ * writes, and syncs in the background so the calling thread does not
+ * stall on slow disks.  Linux io_uring is used where available, otherwise
+ * a pool of worker threads performs the i/o.
+ * @file ucommon/async.h
+ */
+
+#ifndef _UCOMMON_ASYNC_H_
+#define _UCOMMON_ASYNC_H_
+
+#ifndef _UCOMMON_CONDITION_H_
+#include <ucommon/condition.h>
+#endif
+
+#ifndef _UCOMMON_THREAD_H_
+#include <ucommon/thread.h>
+#endif
+
+#ifndef _UCOMMON_FSYS_H_
+#include <ucommon/fsys.h>
+#endif
+
+namespace ucommon {
+
+/**
+ * An asynchronous i/o engine for fsys descriptors.  Reads, writes, and
+ * syncs are staged as request objects, and submit() passes all staged
+ * requests to the engine at once.  With io_uring the whole batch is
+ * handed to the kernel in a single system call and completions are
+ * collected by one thread; otherwise a pool of worker threads performs
+ * the i/o.  A request either is waited on directly, or a derived request
+ * may override completed() to receive a callback.  Requests that use the
+ * current file position, and syncs, complete in the order they were
+ * staged relative to other requests on the same descriptor; positioned
+ * reads and writes may otherwise complete in any order.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT AsyncIO : protected Conditional
+{
+public:
+    /**
+     * A single asynchronous i/o operation.  The request object and any
+     * buffer it refers to must remain valid until it completes.
+     * @author David Sugar <dyfet@gnutelephony.org>
+     */
+    class __EXPORT request
+    {
+    private:
+        friend class AsyncIO;
+
+        request *next;
+        fd_t fd;
+        caddr_t data;
+        size_t size;
+        fsys::offset_t offset;
+        unsigned op;
+        ssize_t count;
+        int error;
+        volatile bool busy;
+
+        __DELETE_COPY(request);
+
+    protected:
+        /**
+         * Notify a derived request that it has completed.  This is
+         * called from an engine thread before the request is marked
+         * complete, so the request must not be deleted from here.
+         */
+        virtual void completed(void);
+
+    public:
+        /**
+         * Create an idle request.
+         */
+        request();
+
+        /**
+         * Destroy request.
+         */
+        virtual ~request();
+
+        /**
+         * Test if the request is staged or in progress.
+         * @return true if not yet completed.
+         */
+        inline bool is_pending(void) const {
+            return busy;
+        }
+
+        /**
+         * Get the result of a completed request.
+         * @return bytes transferred, 0 for sync, or -1 on error.
+         */
+        inline ssize_t result(void) const {
+            return count;
+        }
+
+        /**
+         * Get the number of bytes the request asked to transfer.
+         * @return requested size.
+         */
+        inline size_t length(void) const {
+            return size;
+        }
+
+        /**
+         * Get the error of a completed request.
+         * @return error code or 0 if none.
+         */
+        inline int err(void) const {
+            return error;
+        }
+    };
+
+private:
+    __DELETE_COPY(AsyncIO);
+
+    class __LOCAL worker;
+    class __LOCAL ring;
+    friend class worker;
+
+    worker **threads;
+    ring *uring;
+    unsigned workers;
+    unsigned active;
+    request *staged, *last;
+    request *ready, *tail;
+    request *working;
+    volatile bool running;
+
+    bool stage(request *req, unsigned op, fsys& fs, caddr_t data, size_t size, fsys::offset_t offset);
+    void dispatch(void);
+    void reap(void);
+    void service(void);
+    request *take(void);
+    void complete(request *req, ssize_t result, int error);
+
+public:
+    /**
+     * Create and start an asynchronous i/o engine.
+     * @param depth of the io_uring submission queue.
+     * @param count of worker threads if io_uring is unavailable, 0 for
+     * one per cpu.
+     */
+    AsyncIO(unsigned depth = 64, unsigned count = 0);
+
+    /**
+     * Complete all outstanding requests and stop the engine.
+     */
+    virtual ~AsyncIO();
+
+    /**
+     * Stage a read request.
+     * @param req to use for the operation.
+     * @param fs to read from.
+     * @param data buffer to read into.
+     * @param size of buffer.
+     * @param offset in file, or -1 for the current file position.
+     * @return false if the request is already pending or size is over 2 GiB.
+     */
+    bool read(request *req, fsys& fs, void *data, size_t size, fsys::offset_t offset = -1);
+
+    /**
+     * Stage a write request.
+     * @param req to use for the operation.
+     * @param fs to write to.
+     * @param data buffer to write from.
+     * @param size of data.
+     * @param offset in file, or -1 for the current file position.
+     * @return false if the request is already pending or size is over 2 GiB.
+     */
+    bool write(request *req, fsys& fs, const void *data, size_t size, fsys::offset_t offset = -1);
+
+    /**
+     * Stage a request to sync a file to storage.
+     * @param req to use for the operation.
+     * @param fs to sync.
+     * @return false if the request is already pending.
+     */
+    bool sync(request *req, fsys& fs);
+
+    /**
+     * Submit all staged requests to the engine as one batch.
+     */
+    void submit(void);
+
+    /**
+     * Wait for a request to complete.  Any staged requests are
+     * submitted first.
+     * @param req to wait for.
+     * @return result of request.
+     */
+    ssize_t wait(request *req);
+
+    /**
+     * Wait for all staged and submitted requests to complete.
+     */
+    void wait(void);
+
+    /**
+     * Test if the engine uses io_uring rather than worker threads.
+     * @return true if io_uring is used.
+     */
+    inline bool is_uring(void) const {
+        return uring != NULL;
+    }
+
+    /**
+     * Get the number of submitted requests not yet completed.
+     * @return outstanding requests.
+     */
+    inline unsigned pending(void) const {
+        return active;
+    }
+};
+
+/**
+ * Convenience type for asynchronous i/o engines.
+ */
+typedef AsyncIO aio_t;
+
+} // namespace ucommon
+
+#endif
@@ -82,6 +82,28 @@ public:
         atomic_t get() volatile;
         void clear() volatile;
 
+        /**
+         * Replace value if it still matches what we expect.  This is a
+         * full barrier, and is the building block for lockfree
+         * structures.
+         * @param expected value, updated with current value if no match.
+         * @param value to store.
+         * @return true if stored.
+         */
+        bool compare_exchange(atomic_t& expected, atomic_t value) volatile;
+
+        /**
+         * Update a counter that is only ever used by one thread.  This is
+         * a plain load and store, with no atomic instruction or barrier.
+         * @param offset to add.
+         * @return value before update.
+         */
+        inline atomic_t fetch_local(atomic_t offset = 1) volatile {
+            atomic_t prior = value;
+            value = prior + offset;
+            return prior;
+        }
+
         inline operator atomic_t() volatile {
             return get();
         }
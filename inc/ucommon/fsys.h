@@ -167,7 +167,8 @@ public:
         EXCLUSIVE,
         DEVICE,
         STREAM,
-        RANDOM
+        RANDOM,
+        MAPPED
     } access_t;
 
     /**
@@ -390,13 +391,15 @@ public:
     static int erase(const char *path);
 
     /**
-     * Copy a file.
+     * Copy a file.  Where supported, the copy is done in the kernel with
+     * copy_file_range or sendfile, otherwise through a buffer.  Holes of
+     * sparse files are preserved where the filesystem reports them.
      * @param source file.
      * @param target file.
-     * @param size of buffer.
+     * @param size of buffer used if the copy cannot be offloaded, 0 for default.
      * @return error number or 0 on success.
      */
-    static int copy(const char *source, const char *target, size_t size = 1024);
+    static int copy(const char *source, const char *target, size_t size = 0);
 
     /**
      * Rename a file.
@@ -826,6 +829,77 @@ public:
     }
 };
 
+/**
+ * Parallel recursive directory walker.  Subdirectories are scanned by a
+ * pool of threads, each keeping its own queue of directories to scan and
+ * stealing from the other queues when its own runs dry.  On Linux
+ * directories are read in large getdents64 batches, and the entry type
+ * reported by the directory is used so entries need not be stat'd.
+ * Results are passed to the visit() method of a derived class, or
+ * collected into a StringPager.  Symbolic links are reported but not
+ * followed.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT DirWalker : protected Conditional
+{
+private:
+    __DELETE_COPY(DirWalker);
+
+    class __LOCAL lane;
+    class __LOCAL worker;
+    friend class worker;
+
+    lane *lanes;
+    unsigned workers, depth, pending, queued, idle;
+    StringPager *list;
+    volatile unsigned found;
+
+    void push(unsigned id, const char *path, unsigned level);
+    void service(unsigned id);
+    void scan(unsigned id, const char *path, unsigned level);
+    void entry(unsigned id, char *path, size_t len, const char *name, unsigned type, unsigned level);
+    void accept(const char *path);
+
+protected:
+    /**
+     * Visit an entry found by the walk.  This is called concurrently
+     * from the walker threads.  The default drops hidden entries.
+     * @param path of entry.
+     * @param directory if entry is a directory.
+     * @return true to accept a file or descend into a directory.
+     */
+    virtual bool visit(const char *path, bool directory);
+
+public:
+    /**
+     * Create a directory walker.
+     * @param count of threads to walk with, 0 for one per cpu.
+     * @param maxdepth of subdirectories to descend, 0 for unlimited.
+     */
+    DirWalker(unsigned count = 0, unsigned maxdepth = 0);
+
+    /**
+     * Destroy walker.
+     */
+    virtual ~DirWalker();
+
+    /**
+     * Walk a directory tree, passing entries to visit().
+     * @param path of directory to walk.
+     * @return number of files accepted.
+     */
+    unsigned walk(const char *path);
+
+    /**
+     * Walk a directory tree and collect accepted file paths.  The
+     * collected list is sorted.
+     * @param path of directory to walk.
+     * @param files to add paths to.
+     * @return number of files accepted.
+     */
+    unsigned walk(const char *path, StringPager& files);
+};
+
 /**
  * Convience type for fsys.
  */
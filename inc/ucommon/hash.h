@@ -0,0 +1,100 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+/**
+ * Seeded hashing of keys for in memory indexes.  This is the common hash
+ * used to place named objects, map keys, and socket addresses into hash
+ * tables.  It is fast and mixes every bit of the key, but it is not a
+ * cryptographic digest; use the secure library digests for that.
+ * @file ucommon/hash.h
+ */
+
+#ifndef _UCOMMON_HASH_H_
+#define _UCOMMON_HASH_H_
+
+#ifndef _UCOMMON_CONFIG_H_
+#include <ucommon/platform.h>
+#endif
+
+namespace ucommon {
+
+/**
+ * Seeded key hash.  This is based on wyhash, which multiplies 64 bit
+ * words into a 128 bit product and folds it, so short keys such as
+ * phone numbers, uris, and host addresses are hashed in a few cycles.
+ * Keys are read in native byte order, so hash values are only meant to
+ * be used within a process.  All key indexes use a shared process seed,
+ * which may be changed, for example to a random value, before any of
+ * them are filled.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT Hash
+{
+private:
+    __DELETE_DEFAULTS(Hash);
+
+public:
+    /**
+     * Hash a key with a specific seed.
+     * @param key to hash.
+     * @param size of key in bytes.
+     * @param seed to use.
+     * @return hash value.
+     */
+    static uint64_t get(const void *key, size_t size, uint64_t seed);
+
+    /**
+     * Hash a key with the process seed.
+     * @param key to hash.
+     * @param size of key in bytes.
+     * @return hash value.
+     */
+    static uint64_t get(const void *key, size_t size);
+
+    /**
+     * Hash a string with the process seed.
+     * @param text to hash.
+     * @return hash value.
+     */
+    static uint64_t get(const char *text);
+
+    /**
+     * Mix two words into one.  This may be used to combine a hash with
+     * other fields of a key, such as a port number.
+     * @param first word to mix.
+     * @param second word to mix.
+     * @return mixed value.
+     */
+    static uint64_t mix(uint64_t first, uint64_t second);
+
+    /**
+     * Set the process seed.  This must be done before any key indexes
+     * are filled, since their entries are placed by the current seed.
+     * @param value of seed.
+     */
+    static void seed(uint64_t value);
+
+    /**
+     * Get the process seed.
+     * @return current seed.
+     */
+    static uint64_t seed(void);
+};
+
+} // namespace ucommon
+
+#endif
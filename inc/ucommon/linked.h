@@ -759,6 +759,111 @@ public:
     }
 };
 
+/**
+ * A flat hash index of named objects.  Each slot holds the hash of an
+ * object name and a pointer to the object, and slots are probed linearly
+ * in an open addressed table that is kept at most half full.  Most misses
+ * are rejected by comparing hashes within a cache line, and names are
+ * only compared when hashes match.  The index does not own the objects
+ * it refers to, and may be built over an existing hash map table or the
+ * children of a named tree.  If the objects are later removed or renamed,
+ * the index must be updated or rebuilt.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT NamedIndex
+{
+private:
+    typedef struct {
+        size_t hash;
+        NamedObject *object;
+    } slot_t;
+
+    slot_t *slots;
+    size_t mask;
+    unsigned used;
+
+    __DELETE_COPY(NamedIndex);
+
+    void create(unsigned size);
+
+    void grow(void);
+
+    void insert(size_t hash, NamedObject *object);
+
+public:
+    /**
+     * Create an empty index.
+     * @param size of objects expected.
+     */
+    NamedIndex(unsigned size = 0);
+
+    /**
+     * Create an index of all objects in a hash map table.
+     * @param hash map table to index.
+     * @param size of hash map table.
+     */
+    NamedIndex(NamedObject **hash, unsigned size);
+
+    /**
+     * Create an index of the direct children of a tree node.
+     * @param tree node whose children are indexed.
+     */
+    explicit NamedIndex(const NamedTree *tree);
+
+    /**
+     * Destroy index.  The objects are not released.
+     */
+    ~NamedIndex();
+
+    /**
+     * Add all objects of a hash map table to the index.
+     * @param hash map table to index.
+     * @param size of hash map table.
+     */
+    void add(NamedObject **hash, unsigned size);
+
+    /**
+     * Add the direct children of a tree node to the index.
+     * @param tree node whose children are indexed.
+     */
+    void add(const NamedTree *tree);
+
+    /**
+     * Add an object to the index.  An object already indexed under the
+     * same name is replaced.
+     * @param object to add.
+     * @return object replaced or NULL if none.
+     */
+    NamedObject *add(NamedObject *object);
+
+    /**
+     * Find an object by name.
+     * @param name to find.
+     * @return object found or NULL if none.
+     */
+    NamedObject *find(const char *name) const;
+
+    /**
+     * Remove an object from the index by name.
+     * @param name of object to remove.
+     * @return object removed or NULL if none.
+     */
+    NamedObject *remove(const char *name);
+
+    /**
+     * Remove all objects from the index.
+     */
+    void clear(void);
+
+    /**
+     * Get the number of objects indexed.
+     * @return count of objects.
+     */
+    inline unsigned count(void) const {
+        return used;
+    }
+};
+
 /**
  * A double linked list object.  This is used as a base class for objects
  * that will be organized through ordered double linked lists which allow
@@ -74,8 +74,21 @@ protected:
 		Index();
 
 		Counted *key, *value;
+		size_t hash;
 	};
 
+	/**
+	 * The hash index of a map.  Keys of maps with 64 or more paths are
+	 * spread over a fixed set of lock stripes, so lookups and updates of
+	 * keys in different stripes do not contend; smaller maps use a single
+	 * stripe.  Each stripe is a linear hash table of its own that grows
+	 * by splitting one bucket at a time as entries are added, so the map
+	 * never stops to rehash all of its entries at once.  A stripe pages
+	 * its memory separately and makes its first table on first insert,
+	 * and removed entries are only reused by later inserts into the same
+	 * stripe.
+	 * @author David Sugar <dyfet@gnutelephony.org>
+	 */
 	class __EXPORT Map : public Counted
 	{
     private:
@@ -89,15 +102,53 @@ protected:
 	public:
 		friend class MapRef;
 
-		memalloc pool;
-		condlock_t lock;
-		LinkedObject *free, *last;
-		size_t count, alloc;
+		/**
+		 * A lock stripe of the map.  Buckets are held in segments that
+		 * double in size, so growing never moves existing buckets.
+		 * @author David Sugar <dyfet@gnutelephony.org>
+		 */
+		class __EXPORT Stripe
+		{
+		private:
+			__DELETE_COPY(Stripe);
+
+		public:
+			memalloc pool;
+			condlock_t lock;
+			LinkedObject *free, *last;
+			LinkedObject **segments[32];
+			size_t count, alloc, base, split;
+			unsigned level;
+
+			Stripe(size_t base, size_t paging);
+
+			LinkedObject **table(size_t paths);
+
+			inline size_t buckets(void) const {
+				return segments[0] ? (base << level) + split : 0;
+			}
+
+			LinkedObject **bucket(size_t path);
+
+			LinkedObject **locate(size_t hash);
+
+			LinkedObject *head(size_t hash);
+
+			void grow(void);
+
+			void purge(void);
+		};
+
+		volatile bool frozen;
 
 		explicit Map(void *addr, size_t indexes, size_t paging = 0);
-	
-		inline LinkedObject **get(void) {
-			return reinterpret_cast<LinkedObject **>(((caddr_t)(this)) + sizeof(Map));
+
+		inline Stripe *get(void) {
+			return reinterpret_cast<Stripe *>(((caddr_t)(this)) + sizeof(Map));
+		}
+
+		inline Stripe *stripe(size_t key) {
+			return get() + (key % size);
 		}
 
 		Index *create(size_t path);
@@ -106,9 +157,19 @@ protected:
 
 		void remove(Index *index, size_t path);
 
-		LinkedObject *modify(size_t key = 0);
+		LinkedObject *modify(size_t key);
+
+		LinkedObject *access(size_t key);
+
+		void commit(size_t key);
+
+		void unlock(size_t key);
 
-		LinkedObject *access(size_t key = 0);
+		void enter(void);
+
+		void leave(void);
+
+		void freeze(void);
 	};
 
 	class __EXPORT Instance
@@ -116,7 +177,7 @@ protected:
 	protected:
 		Map *map;
 		LinkedObject *index;
-		size_t path;
+		size_t stripe, path;
 
 		Instance();
 
@@ -158,6 +219,7 @@ protected:
 
 	MapRef(size_t paths, size_t paging = 0);
 	MapRef(const MapRef& copy);
+	MapRef(const typeref_epoch& global);
 	MapRef();
 
 	void assign(TypeRef& key, TypeRef& value);
@@ -176,18 +238,41 @@ protected:
 
 	void remove(Index *ind, size_t path = 0);
 
-	void release();
+	void release(size_t keyvalue = 0);
 
-	void commit();
+	void commit(size_t keyvalue = 0);
+
+	void writable(void);
 
 public:
 	size_t count(void);
 
+	/**
+	 * Get the number of index entries allocated by the map.  Removed
+	 * entries are kept for reuse by their stripe, so this may be more
+	 * than count().
+	 * @return entries allocated.
+	 */
 	size_t used(void);
 
 	void purge(void);
 
 	static size_t index(size_t& key, const uint8_t *addr, size_t len);
+
+	/**
+	 * Rebuild the map with a different number of paths.  The entries are
+	 * copied into a new map, so other references keep the old one.
+	 * @param paths of new map.
+	 */
+	void resize(size_t paths);
+
+	/**
+	 * Publish the map as a read-only snapshot.  Once published, a map is
+	 * read without locking, and changing it through any reference first
+	 * makes a private copy.
+	 * @param target to publish to.
+	 */
+	void publish(typeref_epoch& target);
 };
 
 template<typename T>
@@ -222,12 +307,12 @@ protected:
 			typeref<K> kv(ip->key);
 			if(is(kv) && kv == key) {
 				MapRef::remove(*ip, path);
-				MapRef::commit();
+				MapRef::commit(path);
 				return true;
 			}
 			ip.next();
 		}
-		MapRef::commit();
+		MapRef::commit(path);
 		return false;
 	}	
 
@@ -269,11 +354,18 @@ public:
 
 	inline mapref(size_t paths = 37, size_t paging = 0) : MapRef(paths, paging) {};
 
+	inline mapref(const typeref_epoch& global) : MapRef(global) {};
+
 	inline mapref& operator=(const mapref& copy) {
 		TypeRef::set(copy);
 		return *this;
 	}
 
+	inline mapref& operator=(const typeref_epoch& global) {
+		TypeRef::assign(global);
+		return *this;
+	}
+
 	inline instance operator*() {
 		return instance(this);
 	}
@@ -285,27 +377,28 @@ public:
 			typeref<K> kv(ip->key);
 			if(is(kv) && kv == key) {
 				update(*ip, val);
-				commit();
+				commit(path);
 				return;
 			}
 			ip.next();
 		}
 		add(path, key, val);
-		commit();
+		commit(path);
 	}
 
 	typeref<V> at(typeref<K>& key) {
-		linked_pointer<Index> ip = access(mapkeypath<K>(key));
+		size_t path = mapkeypath<K>(key);
+		linked_pointer<Index> ip = access(path);
 		while(is(ip)) {
 			typeref<K> kv(ip->key);
 			if(is(kv) && kv == key) {
 				typeref<V> result(ip->value);
-				release();
+				release(path);
 				return result;
 			}
 			ip.next();
 		}
-		release();
+		release(path);
 		return typeref<V>();
 	}	
 
@@ -318,12 +411,12 @@ public:
 				typeref<V> result(ip->value);
 				if(is(result.is))
 					MapRef::remove(*ip, path);
-				commit();
+				commit(path);
 				return result;
 			}
 			ip.next();
 		}
-		commit();
+		commit(path);
 		return typeref<V>();
 	}	
 
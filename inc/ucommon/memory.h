@@ -39,6 +39,10 @@
 #include <ucommon/protocols.h>
 #endif
 
+#ifndef _UCOMMON_ATOMIC_H_
+#include <ucommon/atomic.h>
+#endif
+
 #ifndef  _UCOMMON_LINKED_H_
 #include <ucommon/linked.h>
 #endif
@@ -70,11 +74,17 @@ private:
         struct mempage *next;
         union {
             void *memalign;
-            unsigned used;
+            size_t used;
         };
     }   page_t;
 
-    page_t *page;
+    // retired pages that may still have room are kept for reuse
+    static const unsigned partials = 4;
+
+    page_t *page, *current, *large;
+    page_t *partial[partials];
+
+    void *oversize(size_t size);
 
 protected:
     unsigned limit;
@@ -85,6 +95,13 @@ protected:
      */
     page_t *pager(void);
 
+    /**
+     * Get heap usage of the pager in bytes.
+     * @param used portion of heap pages.
+     * @param alloc total size of heap pages.
+     */
+    void usage(unsigned long& used, unsigned long& alloc) const;
+
 public:
     /**
      * Construct a memory pager.
@@ -145,9 +162,12 @@ public:
 
 protected:
     /**
-     * Allocate memory from the pager heap.  The size of the request must be
-     * less than the size of the memory page used.  This implements the
-     * memory protocol allocation method.
+     * Allocate memory from the pager heap.  Requests are carved from the
+     * current page, or from a few recently retired pages that still have
+     * room, so allocation time does not grow with the number of pages.
+     * A request larger than the page size is given its own heap block,
+     * which is still released when the pager is purged.  This implements
+     * the memory protocol allocation method.
      * @param size of memory request.
      * @return allocated memory or NULL if not possible.
      */
@@ -161,6 +181,93 @@ public:
     void assign(memalloc& source);
 };
 
+/**
+ * Per-thread slabs of a shared pager.  Each thread carves small requests
+ * from its own slab without locking, and only locks the pager when it
+ * takes a new slab from it.  Slabs are invalidated when the pager is
+ * purged, so threads then take fresh ones.  This is used by pagers that
+ * are shared between threads, which hold their own lock when refilling
+ * or invalidating slabs.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT memarenas
+{
+private:
+    mutable pthread_mutex_t mutex;
+    pthread_key_t key;
+    LinkedObject *arenas;
+    size_t slab;
+    mutable Atomic::counter generation;
+
+    __DELETE_COPY(memarenas);
+
+public:
+    /**
+     * Create an inactive set of thread slabs.
+     */
+    memarenas();
+
+    /**
+     * Release the slab records of all threads.
+     */
+    ~memarenas();
+
+    /**
+     * Enable thread slabs.
+     * @param size of slab each thread takes from the pager.
+     * @return true if enabled.
+     */
+    bool enable(size_t size);
+
+    /**
+     * Get the size of thread slabs.
+     * @return slab size or 0 if not enabled.
+     */
+    inline size_t size(void) const {
+        return slab;
+    }
+
+    /**
+     * Test if a request is small enough to take from a thread slab.
+     * @param size of request, rounded to pointer size.
+     * @return true if taken from a slab.
+     */
+    inline bool fits(size_t size) const {
+        return slab && size <= slab / 4;
+    }
+
+    /**
+     * Take a request from the slab of the calling thread without locking.
+     * @param size of request.
+     * @return memory or NULL if the slab must be refilled.
+     */
+    void *get(size_t size);
+
+    /**
+     * Give the calling thread a new slab and take a request from it.
+     * The pager must be locked.
+     * @param memory of new slab from the pager.
+     * @param size of request.
+     * @return memory or NULL if no slab.
+     */
+    void *refill(void *memory, size_t size);
+
+    /**
+     * Invalidate all thread slabs before pager memory is released.  The
+     * pager must be locked.
+     */
+    void invalidate(void);
+
+    /**
+     * Compute pager utilization, not counting the unused part of current
+     * thread slabs as used.  The pager must be locked.
+     * @param used portion of heap pages.
+     * @param alloc total size of heap pages.
+     * @return utilization (0-100).
+     */
+    unsigned utilization(unsigned long used, unsigned long alloc) const;
+};
+
 /**
  * A managed private heap for small allocations.  This is used to allocate
  * a large number of small objects from a paged heap as needed and to then
@@ -174,17 +281,18 @@ public:
  * The mempager uses a strategy of allocating fixed size pages as needed
  * from the real heap and allocating objects from these pages as needed.
  * A new page is allocated from the real heap when there is insufficient
- * space in the existing page to complete a request.  The largest single
- * memory allocation one can make is restricted by the page size used, and
- * it is best to allocate objects a significant fraction smaller than the
- * page size, as fragmentation occurs at the end of pages when there is
- * insufficient space in the current page to complete a request.
+ * space in the existing page to complete a request.  Requests larger than
+ * the page size are allocated as separate heap blocks, but it is best to
+ * allocate objects a significant fraction smaller than the page size, as
+ * fragmentation occurs at the end of pages when there is insufficient
+ * space in the current page to complete a request.
  * @author David Sugar <dyfet@gnutelephony.org>
  */
 class __EXPORT mempager : public memalloc, public __PROTOCOL LockingProtocol
 {
 private:
     mutable pthread_mutex_t mutex;
+    memarenas arenas;
 
 protected:
     /**
@@ -231,6 +339,24 @@ public:
      */
     void purge(void);
 
+    /**
+     * Enable per-thread allocation arenas.  Each thread then carves small
+     * requests from its own slab, which it takes in bulk from the pager,
+     * so the pager mutex is only locked when a slab is refilled.  Slabs
+     * are part of the pager heap, and are counted in pages and limits.
+     * This should be called before the pager is shared between threads.
+     * @param size of slab each thread takes, 0 for a quarter page.
+     */
+    void caching(size_t size = 0);
+
+    /**
+     * Test if per-thread arenas are used.
+     * @return true if caching.
+     */
+    inline bool is_caching(void) const {
+        return arenas.size() != 0;
+    }
+
     /**
      * Return memory back to pager heap.  This actually does nothing, but
      * might be used in a derived class to create a memory heap that can
@@ -242,10 +368,10 @@ public:
 
 protected:
     /**
-     * Allocate memory from the pager heap.  The size of the request must be
-     * less than the size of the memory page used.  This impliments the
-     * memory protocol with mutex locking for thread safety.
-     * is locked during this operation and then released.
+     * Allocate memory from the pager heap.  This impliments the memory
+     * protocol with mutex locking for thread safety.  The pager is locked
+     * during this operation and then released, unless the request can be
+     * taken from the per-thread arena of the caller.
      * @param size of memory request.
      * @return allocated memory or NULL if not possible.
      */
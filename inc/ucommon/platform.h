@@ -355,6 +355,9 @@ extern "C" {
     inline void pthread_mutex_lock(pthread_mutex_t *mutex)
         {EnterCriticalSection(mutex);}
 
+    inline int pthread_mutex_trylock(pthread_mutex_t *mutex)
+        {return TryEnterCriticalSection(mutex) ? 0 : -1;}
+
     inline void pthread_mutex_unlock(pthread_mutex_t *mutex)
         {LeaveCriticalSection(mutex);}
 #endif
@@ -394,6 +397,9 @@ inline void pthread_mutex_destroy(pthread_mutex_t *mutex)
 inline void pthread_mutex_lock(pthread_mutex_t *mutex)
     {pth_mutex_acquire(mutex, 0, nullptr);};
 
+inline int pthread_mutex_trylock(pthread_mutex_t *mutex)
+    {return pth_mutex_acquire(mutex, TRUE, nullptr) ? 0 : -1;};
+
 inline void pthread_mutex_unlock(pthread_mutex_t *mutex)
     {pth_mutex_release(mutex);};
 
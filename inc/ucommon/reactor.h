@@ -0,0 +1,315 @@
+// Copyright (C) 2006-2014 David Sugar, Tycho Softworks.
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+/**
+ * Event driven tcp server.  This offers a reactor that multiplexes many
+ * accepted client sockets through a single event thread and dispatches
+ * socket readiness to a fixed pool of worker threads, rather than using
+ * a thread for each connected client.  Epoll is used where available,
+ * otherwise poll.
+ * @file ucommon/reactor.h
+ */
+
+#ifndef _UCOMMON_REACTOR_H_
+#define _UCOMMON_REACTOR_H_
+
+#ifndef _UCOMMON_SOCKET_H_
+#include <ucommon/socket.h>
+#endif
+
+#ifndef _UCOMMON_CONDITION_H_
+#include <ucommon/condition.h>
+#endif
+
+#ifndef _UCOMMON_THREAD_H_
+#include <ucommon/thread.h>
+#endif
+
+namespace ucommon {
+
+/**
+ * A tcp server that services many clients from a bounded set of threads.
+ * A single event thread accepts connections and waits for socket
+ * readiness using edge triggered epoll (or poll as a fallback).  Ready
+ * connections are queued to a fixed pool of worker threads which fill the
+ * connection input buffer, call the input() method of the derived server,
+ * and then flush any output the server wrote.  Each connection is only
+ * serviced by one worker at a time, so per connection state needs no
+ * additional locking.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT TCPReactor : public TCPServer, protected Conditional
+{
+public:
+    /**
+     * A connected client of the reactor.  This holds the socket and the
+     * buffered input and output of the client.  A derived class may be
+     * created from the reactor create() method to hold per client state.
+     * @author David Sugar <dyfet@gnutelephony.org>
+     */
+    class __EXPORT connection : public DLinkedObject
+    {
+    private:
+        friend class TCPReactor;
+
+        connection *queued;
+        socket_t so;
+        struct sockaddr_storage peer;
+        caddr_t ibuf, obuf;
+        size_t bufsize, ihead, itail, ohead, otail;
+        bool busy, closing, eof;
+        int ioerr;
+
+        __DELETE_COPY(connection);
+
+        bool fill(void);
+        bool flush(void);
+
+    protected:
+        /**
+         * Create a client connection for an accepted socket.
+         * @param socket of the accepted client.
+         * @param size of input and output buffers.
+         */
+        connection(socket_t socket, size_t size);
+
+    public:
+        /**
+         * Destroy connection and release buffers.  The socket is closed
+         * by the reactor before the connection is destroyed.
+         */
+        virtual ~connection();
+
+        /**
+         * Get the socket descriptor of the client.
+         * @return socket descriptor.
+         */
+        inline socket_t handle(void) const {
+            return so;
+        }
+
+        /**
+         * Get the address of the connected peer.
+         * @return peer address.
+         */
+        inline const struct sockaddr *address(void) const {
+            return (const struct sockaddr *)&peer;
+        }
+
+        /**
+         * Get the number of bytes waiting in the input buffer.
+         * @return bytes available to read.
+         */
+        inline size_t available(void) const {
+            return itail - ihead;
+        }
+
+        /**
+         * Get the start of unconsumed input.  This is a view into the
+         * input buffer and is valid until consume() is called.
+         * @return pointer to input data.
+         */
+        inline const char *get(void) const {
+            return ibuf + ihead;
+        }
+
+        /**
+         * Get the number of bytes still waiting to be sent.
+         * @return bytes in output buffer.
+         */
+        inline size_t pending(void) const {
+            return otail - ohead;
+        }
+
+        /**
+         * Get the last socket error of the client.
+         * @return error code or 0 if none.
+         */
+        inline int err(void) const {
+            return ioerr;
+        }
+
+        /**
+         * Get the size of the input and output buffers.
+         * @return buffer size.
+         */
+        inline size_t size(void) const {
+            return bufsize;
+        }
+
+        /**
+         * Mark the connection to be closed.  Any pending output is
+         * flushed before the client socket is closed.
+         */
+        inline void close(void) {
+            closing = true;
+        }
+
+        /**
+         * Discard input that has been processed.
+         * @param size of input to remove from the input buffer.
+         */
+        void consume(size_t size);
+
+        /**
+         * Copy a line of input to a buffer and consume it.  The trailing
+         * newline (and any carriage return) is dropped.
+         * @param data to save line into.
+         * @param max size of buffer, including null byte.
+         * @return size of input consumed, 0 if no complete line waiting.
+         */
+        size_t readline(char *data, size_t max);
+
+        /**
+         * Queue data to send to the client.  Output is buffered and sent
+         * by the reactor when the input() callback returns.  If the output
+         * buffer is full, an immediate send is attempted to make space.
+         * @param data to send.
+         * @param size of data to send.
+         * @return number of bytes accepted.
+         */
+        size_t write(const void *data, size_t size);
+
+        /**
+         * Queue a null terminated string to send to the client.
+         * @param string to send.
+         * @return number of bytes accepted.
+         */
+        size_t writes(const char *string);
+    };
+
+private:
+    __DELETE_DEFAULTS(TCPReactor);
+
+    class __LOCAL loop;
+    friend class loop;
+
+    loop **threads;
+    unsigned workers;
+    size_t bufsize;
+    int events;
+    socket_t wakeup[2];
+    OrderedIndex active;
+    connection *head, *tail;
+    unsigned clients;
+    volatile bool running;
+
+    void dispatch(void);
+    void service(void);
+    void service(connection *client);
+    void accepting(void);
+    void queue(connection *client);
+    void arm(connection *client);
+    void drop(connection *client);
+    void wake(void);
+
+protected:
+    /**
+     * Create connection object for accepted client.  This may be used to
+     * create a derived connection holding per client state.
+     * @param socket of accepted client.
+     * @param size of connection buffers.
+     * @return connection object.
+     */
+    virtual connection *create(socket_t socket, size_t size);
+
+    /**
+     * Notify derived server that a client was accepted.  This is called
+     * from the event thread before the client is first serviced.
+     * @param client that connected.
+     * @return false to reject and close the client.
+     */
+    virtual bool accepted(connection *client);
+
+    /**
+     * Process input from a client.  This is called from a worker thread
+     * whenever new input is buffered.  Only one worker services a client
+     * at a time.
+     * @param client with input available.
+     */
+    virtual void input(connection *client) = 0;
+
+    /**
+     * Notify derived server that a client is being disconnected.  This
+     * is called before the connection object is destroyed.
+     * @param client being disconnected.
+     */
+    virtual void disconnect(connection *client);
+
+public:
+    /**
+     * Create and bind a reactor tcp server.
+     * @param address of interface to bind or "*" for all.
+     * @param service port to bind.
+     * @param workers in the worker pool, 0 for one per cpu.
+     * @param backlog size for pending connections.
+     * @param size of per client input and output buffers, 0 for default.
+     */
+    TCPReactor(const char *address, const char *service, unsigned workers = 0, unsigned backlog = 5, size_t size = 0);
+
+    /**
+     * Stop the reactor and disconnect all clients.  A derived server
+     * should call stop() from its own destructor, since workers may
+     * otherwise call into a partially destroyed object.
+     */
+    virtual ~TCPReactor();
+
+    /**
+     * Start the event thread and the worker pool.
+     * @param priority of reactor threads.
+     */
+    void start(int priority = 0);
+
+    /**
+     * Stop the event thread and worker pool and disconnect all clients.
+     */
+    void stop(void);
+
+    /**
+     * Get the number of connected clients.
+     * @return connected clients.
+     */
+    inline unsigned count(void) const {
+        return clients;
+    }
+
+    /**
+     * Get the number of worker threads.
+     * @return worker pool size.
+     */
+    inline unsigned pool(void) const {
+        return workers;
+    }
+
+    /**
+     * Test if the reactor is running.
+     * @return true if started.
+     */
+    inline bool is_active(void) const {
+        return running;
+    }
+};
+
+/**
+ * Convenience type for event driven tcp servers.
+ */
+typedef TCPReactor tcpreactor_t;
+
+} // namespace ucommon
+
+#endif
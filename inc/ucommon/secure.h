@@ -518,7 +518,7 @@ private:
 
     unsigned bufsize;
     uint8_t buffer[MAX_DIGEST_HASHSIZE / 8];
-    char textbuf[MAX_DIGEST_HASHSIZE / 8 + 1];
+    char textbuf[MAX_DIGEST_HASHSIZE / 4 + 1];
 
     __DELETE_COPY(Digest);
 
@@ -645,6 +645,19 @@ public:
 
     static secure::keybytes sha384(const uint8_t *mem, size_t size);
 
+    /**
+     * Compute the digests of many independent messages in one call.  This
+     * avoids creating and resetting a digest object for each message, and
+     * lets the backend share setup or hash several messages in parallel.
+     * @param type of digest to use.
+     * @param count of messages.
+     * @param data of each message.
+     * @param size of each message.
+     * @param digests to save each result into, MAX_DIGEST_HASHSIZE / 8
+     * bytes each.
+     * @return size of each digest in bytes, 0 if not supported.
+     */
+    static unsigned batch(const char *type, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **digests);
 };
 
 /**
@@ -655,6 +668,58 @@ public:
  */
 class __SHARED HMAC
 {
+public:
+    /**
+     * A prepared hmac key.  The digest states of the inner and outer key
+     * pads are computed once when the key is set, and each hmac created
+     * from the key copies those states rather than processing the key
+     * again.  This is useful to authenticate many messages with one key.
+     * @author David Sugar <dyfet@gnutelephony.org>
+     */
+    class __SHARED Key
+    {
+    private:
+        friend class HMAC;
+
+        void *context;
+
+        union {
+            const void *keytype;
+            int keyid;
+        };
+
+        secure::keybytes keydata;
+
+        __DELETE_COPY(Key);
+
+    public:
+        Key();
+
+        Key(const char *digest, const secure::keybytes& key);
+
+        ~Key();
+
+        /**
+         * Prepare a key for a digest.
+         * @param digest to use.
+         * @param key to authenticate with.
+         */
+        void set(const char *digest, const secure::keybytes& key);
+
+        /**
+         * Clear the prepared key.
+         */
+        void clear(void);
+
+        inline operator bool() const {
+            return context != NULL;
+        }
+
+        inline bool operator!() const {
+            return context == NULL;
+        }
+    };
+
 private:
     void *context;
 
@@ -665,7 +730,7 @@ private:
 
     unsigned bufsize;
     uint8_t buffer[MAX_DIGEST_HASHSIZE / 8];
-    char textbuf[MAX_DIGEST_HASHSIZE / 8 + 1];
+    char textbuf[MAX_DIGEST_HASHSIZE / 4 + 1];
 
     __DELETE_COPY(HMAC);
 
@@ -677,6 +742,8 @@ protected:
 public:
     HMAC(const char *digest, const secure::keybytes& key);
 
+    HMAC(const Key& key);
+
     HMAC();
 
     ~HMAC();
@@ -729,6 +796,13 @@ public:
 
     void set(const char *digest, const secure::keybytes& key);
 
+    /**
+     * Start a new hmac from a prepared key.  This copies the prepared
+     * key pad states, so it is cheap enough to do for each message.
+     * @param key to start from.
+     */
+    void set(const Key& key);
+
     inline bool operator +=(const char *text) {
         return puts(text);
     }
@@ -755,6 +829,22 @@ public:
     static secure::keybytes sha256(secure::keybytes key, const uint8_t *mem, size_t size);
 
     static secure::keybytes sha384(secure::keybytes key, const uint8_t *mem, size_t soze);
+
+    /**
+     * Compute the message authentication codes of many independent
+     * messages with one key in one call.  The key is prepared once for
+     * the whole batch, and the backend may hash several messages in
+     * parallel.
+     * @param digest to use.
+     * @param key to authenticate with.
+     * @param count of messages.
+     * @param data of each message.
+     * @param size of each message.
+     * @param results to save each code into, MAX_DIGEST_HASHSIZE / 8
+     * bytes each.
+     * @return size of each code in bytes, 0 if not supported.
+     */
+    static unsigned batch(const char *digest, const secure::keybytes& key, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **results);
 };
 
 /**
@@ -923,6 +1013,14 @@ protected:
 
     bool _wait(void) __OVERRIDE;
 
+    inline ssize_t _sendfile(fsys& file, fsys::offset_t offset, size_t size) __OVERRIDE {
+        return bio ? _copyfile(file, offset, size) : tcpstream::_sendfile(file, offset, size);
+    }
+
+    inline ssize_t _writev(const char *head, size_t hsize, const char *data, size_t dsize) __OVERRIDE {
+        return bio ? _writes(head, hsize, data, dsize) : tcpstream::_writev(head, hsize, data, dsize);
+    }
+
 public:
     /**
      * Construct a ssl client stream.  The context will be loaded with
@@ -43,6 +43,10 @@
 #include <ucommon/typeref.h>
 #endif
 
+#ifndef _UCOMMON_FSYS_H_
+#include <ucommon/fsys.h>
+#endif
+
 extern "C" {
     struct addrinfo;
 }
@@ -56,6 +60,7 @@ typedef uint32_t in_addr_t;
 #else
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -183,6 +188,98 @@ public:
      */
     typedef LinkedObject policy;
 
+    /**
+     * A compiled lookup table for cidr policies.  This holds a path
+     * compressed binary trie for each address family, so that finding the
+     * longest or shortest matching prefix of an address costs at most one
+     * node per prefix bit rather than a test of every cidr in a policy
+     * chain.  The table only references the cidr objects, which must
+     * remain valid while the table is used.  The table is not locked, and
+     * changes should be protected from concurrent lookups by the caller.
+     * @author David Sugar <dyfet@gnutelephony.org>
+     */
+    class __EXPORT table
+    {
+    private:
+        class __LOCAL node;
+
+        node *inet4, *inet6;
+        unsigned count;
+
+        __DELETE_COPY(table);
+
+        node **root(int family);
+        const node *root(int family) const;
+
+    public:
+        /**
+         * Create an empty cidr table.
+         */
+        table();
+
+        /**
+         * Create a cidr table compiled from a policy chain.
+         * @param policy chain to add.
+         */
+        table(const policy *policy);
+
+        /**
+         * Destroy table.  The cidr objects are not released.
+         */
+        ~table();
+
+        /**
+         * Add all cidr entries of a policy chain.  Entries of equal
+         * prefix found earlier in the chain take precedence, as they
+         * would with the cidr::find() chain search.
+         * @param policy chain to add.
+         */
+        void add(const policy *policy);
+
+        /**
+         * Insert a single cidr entry.  For entries with the same prefix,
+         * the earliest inserted is returned by lookups.
+         * @param entry to insert.
+         */
+        void insert(const cidr *entry);
+
+        /**
+         * Remove a single cidr entry.
+         * @param entry to remove.
+         * @return true if entry was found and removed.
+         */
+        bool remove(const cidr *entry);
+
+        /**
+         * Remove all entries from the table.
+         */
+        void clear(void);
+
+        /**
+         * Find the smallest cidr entry that matches the socket address.
+         * This has the same result as cidr::find() for the policy chain.
+         * @param address to search for.
+         * @return smallest cidr or NULL if none match.
+         */
+        const cidr *find(const struct sockaddr *address) const;
+
+        /**
+         * Get the largest container cidr entry that matches the socket
+         * address.  This has the same result as cidr::container().
+         * @param address to search for.
+         * @return largest cidr or NULL if none match.
+         */
+        const cidr *container(const struct sockaddr *address) const;
+
+        /**
+         * Get the number of cidr entries in the table.
+         * @return number of entries.
+         */
+        inline unsigned size(void) const {
+            return count;
+        }
+    };
+
     /**
      * Create an uninitialized cidr.
      */
@@ -326,10 +423,14 @@ public:
  */
 class __EXPORT Socket
 {
+public:
+    class reader;
+
 protected:
     socket_t so;
     int ioerr;
     timeout_t iowait;
+    reader *input;
 
 public:
     // temporary splints...
@@ -897,6 +998,130 @@ public:
      */
     virtual ~Socket();
 
+    /**
+     * A buffered line reader for a connected stream socket.  This owns a
+     * receive buffer which is filled with as much input as is waiting in a
+     * single recv, so a line oriented protocol usually needs one system
+     * call per message rather than a peek and a read for every line.
+     * Lines are returned as views into the receive buffer.
+     * @author David Sugar <dyfet@gnutelephony.org>
+     */
+    class __EXPORT reader
+    {
+    private:
+        socket_t so;
+        char *buffer;
+        size_t bufsize, head, tail, scan;
+        bool eol;
+        int ioerr;
+
+        __DELETE_COPY(reader);
+
+        bool fill(timeout_t timeout);
+        char *next(size_t *size, size_t limit, timeout_t timeout);
+
+    public:
+        /**
+         * Create a line reader for a socket.  The socket is not owned
+         * by the reader.
+         * @param socket to read from.
+         * @param size of receive buffer, which limits line length.
+         */
+        reader(socket_t socket, size_t size = 2048);
+
+        /**
+         * Release receive buffer.
+         */
+        ~reader();
+
+        /**
+         * Get the next line of input as a view into the receive buffer.
+         * The trailing newline (and any carriage return) is replaced by a
+         * null byte.  The line is consumed, and the view remains valid
+         * until the next call to the reader.  A line longer than the
+         * receive buffer is returned in receive buffer sized parts.
+         * @param size of line returned, without newline.
+         * @param timeout to wait for input.
+         * @return pointer to line or NULL if eof, error, or timeout.
+         */
+        const char *getline(size_t *size, timeout_t timeout = Timer::inf);
+
+        /**
+         * Copy the next line of input to a buffer.  The return size
+         * matches Socket::readline, and counts the dropped newline.
+         * @param data to save input line.
+         * @param size of input line buffer.
+         * @param timeout to wait for input.
+         * @return number of bytes read, 0 if none, -1 if error.
+         */
+        ssize_t readline(char *data, size_t size, timeout_t timeout = Timer::inf);
+
+        /**
+         * Read data from the receive buffer, or from the socket if the
+         * receive buffer is empty.
+         * @param data to save input into.
+         * @param size of data to read.
+         * @return number of bytes read, 0 if none, -1 if error.
+         */
+        ssize_t read(void *data, size_t size);
+
+        /**
+         * Copy data from the receive buffer without consuming it.
+         * @param data to save input into.
+         * @param size of data to copy.
+         * @return number of bytes copied, 0 if none are buffered.
+         */
+        size_t peek(void *data, size_t size) const;
+
+        /**
+         * Get the number of bytes held in the receive buffer.
+         * @return buffered bytes.
+         */
+        inline size_t available(void) const {
+            return tail - head;
+        }
+
+        /**
+         * Get the last socket error of the reader.
+         * @return error code or 0 if none.
+         */
+        inline int err(void) const {
+            return ioerr;
+        }
+    };
+
+    /**
+     * A datagram for batched socket i/o.  On receive, size is the size
+     * of the data buffer and the sender is saved in peer.  On send, size
+     * is the length of the message and peer is the destination, or has
+     * a family of 0 for a connected socket.  The number of bytes actually
+     * moved for each datagram is saved in result.
+     */
+    struct datagram {
+        void *data;
+        size_t size;
+        size_t result;
+        struct sockaddr_storage peer;
+    };
+
+    /**
+     * Buffer socket input through a line reader.  When enabled, readline,
+     * readfrom, and peek operate on the buffered input, and each line
+     * usually costs a single recv rather than a peek and a read.  Any
+     * previously buffered input is discarded.  This should be set once
+     * the socket is connected.
+     * @param size of receive buffer, or 0 to disable buffering.
+     */
+    void buffering(size_t size = 2048);
+
+    /**
+     * Test if socket input is buffered.
+     * @return true if buffered.
+     */
+    inline bool is_buffered(void) const {
+        return input != NULL;
+    }
+
     /**
      * Cancel pending i/o by shutting down the socket.
      */
@@ -970,9 +1195,7 @@ public:
      * Get the number of bytes of data in the socket receive buffer.
      * @return bytes pending.
      */
-    inline unsigned pending(void) const {
-        return pending(so);
-    }
+    unsigned pending(void) const;
 
     /**
      * Set socket for unicast mode broadcasts.
@@ -1205,10 +1428,59 @@ public:
      */
     size_t writeto(const void *data, size_t number, const struct sockaddr *address = NULL);
 
+    /**
+     * Read a batch of datagrams from the socket.  This waits for the
+     * first datagram, and then collects any others already waiting,
+     * using a single recvmmsg where supported.
+     * @param list of datagrams to receive into.
+     * @param count of datagrams in list.
+     * @return number of datagrams received, 0 if none, err() has error.
+     */
+    unsigned readmsgs(datagram *list, unsigned count);
+
+    /**
+     * Write a batch of datagrams to the socket, using a single sendmmsg
+     * where supported.
+     * @param list of datagrams to send.
+     * @param count of datagrams in list.
+     * @return number of datagrams sent, 0 if none, err() has error.
+     */
+    unsigned writemsgs(datagram *list, unsigned count);
+
+    /**
+     * Send part of a file on a connected stream socket.  This uses the
+     * kernel sendfile where supported so the file is not copied through
+     * user memory.
+     * @param file to send from.
+     * @param offset in file to start from.
+     * @param size of data to send.
+     * @return number of bytes sent, 0 if none, err() has error.
+     */
+    size_t sendfile(fsys& file, fsys::offset_t offset, size_t size);
+
+#ifndef _MSWINDOWS_
+    /**
+     * Read data from the socket into a set of buffers.
+     * @param list of buffers to read into.
+     * @param count of buffers in list.
+     * @return number of bytes read, 0 if none, err() has error.
+     */
+    size_t readv(const struct iovec *list, unsigned count);
+
+    /**
+     * Write data to the socket from a set of buffers in a single call.
+     * @param list of buffers to write from.
+     * @param count of buffers in list.
+     * @return number of bytes written, 0 if none, err() has error.
+     */
+    size_t writev(const struct iovec *list, unsigned count);
+#endif
+
     /**
      * Read a newline of text data from the socket and save in NULL terminated
      * string.  This uses an optimized I/O method that takes advantage of
-     * socket peeking.  This presumes a connected socket on a streamble
+     * socket peeking, or the receive buffer if input is buffered.  This
+     * presumes a connected socket on a streamble
      * protocol.  Because the trailing newline is dropped, the return size
      * may be greater than the string length.  If there was no data read
      * because of eof of data, an error has occured, or timeout without
@@ -1239,6 +1511,13 @@ public:
      */
     size_t readline(String& buffer);
 
+    /**
+     * Read a string of input from the socket into a new string reference
+     * and strip trailing newline.  The receive buffer is used if input
+     * is buffered.
+     * @param maxsize of string to read.
+     * @return string read, empty if none.
+     */
     stringref_t readline(size_t maxsize);
 
     /**
@@ -1508,6 +1787,65 @@ public:
         return sendto(socket, buffer, size, flags, (const struct sockaddr *)address);
     }
 
+    /**
+     * Get a batch of datagrams waiting in the receive queue.  Only the
+     * first datagram is waited for.  This uses recvmmsg where supported,
+     * and otherwise receives one datagram at a time.
+     * @param socket to get from.
+     * @param list of datagrams to receive into.
+     * @param count of datagrams in list.
+     * @param flags for i/o operation.
+     * @return number of datagrams received, -1 if error.
+     */
+    static int recvmsgs(socket_t socket, datagram *list, unsigned count, int flags = 0);
+
+    /**
+     * Send a batch of datagrams.  This uses sendmmsg where supported,
+     * and otherwise sends one datagram at a time.
+     * @param socket to send on.
+     * @param list of datagrams to send.
+     * @param count of datagrams in list.
+     * @param flags for i/o operation.
+     * @return number of datagrams sent, -1 if error.
+     */
+    static int sendmsgs(socket_t socket, datagram *list, unsigned count, int flags = 0);
+
+    /**
+     * Send part of a file on a connected stream socket.  This uses
+     * sendfile where supported, then a memory mapped send, and otherwise
+     * sends through a buffer.  Fewer bytes than requested are sent if the
+     * file is shorter or the socket is non-blocking.  The buffered
+     * fallback may move the file position.
+     * @param socket to send on.
+     * @param file to send from.
+     * @param offset in file to start from.
+     * @param size of data to send.
+     * @return number of bytes sent, -1 if error.
+     */
+    static ssize_t sendfile(socket_t socket, fsys& file, fsys::offset_t offset, size_t size);
+
+#ifndef _MSWINDOWS_
+    /**
+     * Get data waiting in receive queue into a set of buffers.
+     * @param socket to get from.
+     * @param list of buffers to receive into.
+     * @param count of buffers in list.
+     * @param flags for i/o operation.
+     * @return number of bytes received, -1 if error.
+     */
+    static ssize_t recvv(socket_t socket, const struct iovec *list, unsigned count, int flags = 0);
+
+    /**
+     * Send data from a set of buffers in a single call.
+     * @param socket to send on.
+     * @param list of buffers to send.
+     * @param count of buffers in list.
+     * @param flags for i/o operation.
+     * @return number of bytes sent, -1 if error.
+     */
+    static ssize_t sendv(socket_t socket, const struct iovec *list, unsigned count, int flags = 0);
+#endif
+
     /**
      * Bind the socket descriptor to a known interface and service port.
      * @param socket descriptor to bind.
@@ -46,6 +46,10 @@
 #include <ucommon/fsys.h>
 #endif
 
+#ifndef _UCOMMON_ASYNC_H_
+#include <ucommon/async.h>
+#endif
+
 #ifndef _UCOMMON_SHELL_H_
 #include <ucommon/shell.h>
 #endif
@@ -120,13 +124,56 @@ private:
 protected:
     socket_t so;
     timeout_t timeout;
+    bool bulk;
 
     virtual ssize_t _read(char *buffer, size_t size);
 
     virtual ssize_t _write(const char *buffer, size_t size);
 
+    /**
+     * Write pending output and new data together.  By default this is
+     * a single gathered write on the socket.
+     * @param head of pending output.
+     * @param hsize of pending output.
+     * @param data to write after pending output.
+     * @param dsize of data.
+     * @return number of bytes written, -1 if error.
+     */
+    virtual ssize_t _writev(const char *head, size_t hsize, const char *data, size_t dsize);
+
+    /**
+     * Write pending output and new data through the _write method.  This
+     * is used by derived streams that must process all output.
+     * @param head of pending output.
+     * @param hsize of pending output.
+     * @param data to write after pending output.
+     * @param dsize of data.
+     * @return number of bytes written, -1 if error.
+     */
+    ssize_t _writes(const char *head, size_t hsize, const char *data, size_t dsize);
+
     virtual bool _wait(void);
 
+    /**
+     * Send part of a file on the connection.  By default this is sent
+     * directly on the socket, bypassing the stream buffer.
+     * @param file to send from.
+     * @param offset in file to start from.
+     * @param size of data to send.
+     * @return number of bytes sent, -1 if error.
+     */
+    virtual ssize_t _sendfile(fsys& file, fsys::offset_t offset, size_t size);
+
+    /**
+     * Send part of a file through the _write method.  This is used by
+     * derived streams that must process all output, such as for ssl.
+     * @param file to send from.
+     * @param offset in file to start from.
+     * @param size of data to send.
+     * @return number of bytes sent, -1 if error.
+     */
+    ssize_t _copyfile(fsys& file, fsys::offset_t offset, size_t size);
+
     /**
      * Release the tcp stream and destroy the underlying socket.
      */
@@ -148,6 +195,26 @@ protected:
      */
     int overflow(int ch) __OVERRIDE;
 
+    /**
+     * Bulk read from the stream.  When bulk buffering is enabled, reads
+     * larger than the stream buffer are received directly into the
+     * caller's memory.
+     * @param data to read into.
+     * @param size of data to read.
+     * @return number of bytes read.
+     */
+    std::streamsize xsgetn(char *data, std::streamsize size) __OVERRIDE;
+
+    /**
+     * Bulk write to the stream.  When bulk buffering is enabled, writes
+     * larger than the stream buffer are sent directly from the caller's
+     * memory together with any pending output.
+     * @param data to write.
+     * @param size of data to write.
+     * @return number of bytes written.
+     */
+    std::streamsize xsputn(const char *data, std::streamsize size) __OVERRIDE;
+
     inline socket_t getsocket(void) const {
         return so;
 	}
@@ -225,6 +292,35 @@ public:
      * socket but is a disconnect.
      */
     void close(void);
+
+    /**
+     * Send part of a file on the stream connection.  Pending output in
+     * the stream buffer is flushed first, and the file contents are then
+     * sent without copying through the stream buffer where possible.
+     * @param file to send from.
+     * @param offset in file to start from.
+     * @param size of data to send.
+     * @return number of bytes sent.
+     */
+    size_t sendfile(fsys& file, fsys::offset_t offset, size_t size);
+
+    /**
+     * Set a large stream buffer for bulk transfers.  The stream buffer is
+     * normally sized from the tcp segment size.  With bulk buffering, each
+     * read returns whatever input is waiting rather than a full buffer,
+     * and reads or writes larger than the buffer bypass it.  Pending input
+     * and output are kept.  This is reset if the stream is re-opened.
+     * @param size of stream buffer.
+     */
+    void buffering(size_t size = 65536);
+
+    /**
+     * Test if bulk buffering is enabled.
+     * @return true if bulk buffered.
+     */
+    inline bool is_bulk(void) const {
+        return bulk;
+    }
 };
 
 /**
@@ -340,7 +436,10 @@ public:
 /**
  * Streamable file class based on low level fsys io.  This differs from
  * the normal fstream classes as it may apply to other kinds of
- * file streams.
+ * file streams.  When opened with fsys::MAPPED access, a regular file is
+ * memory mapped read-only and the mapping is used directly as the get
+ * area, so input is parsed in place without further system calls.  Files
+ * larger than the mapping window are read by sliding the window forward.
  *
  * @author David Sugar <dyfet@gnutelephony.org>
  */
@@ -354,7 +453,20 @@ public:
     } access_t;
 
 private:
+    caddr_t map;
+    size_t maplen;
+    fsys::offset_t mapbase, mapsize;
+    bool mapped;
+    AsyncIO *aio;
+    AsyncIO::request *wreq;
+    char *wbuf;
+    size_t wlen;
+
     __LOCAL void allocate(size_t size, fsys::access_t mode);
+    __LOCAL void mapping(size_t size);
+    __LOCAL bool remap(fsys::offset_t offset);
+    __LOCAL void unmap(void);
+    __LOCAL bool drain(void);
 
 protected:
     fsys_t fd;
@@ -441,6 +553,32 @@ public:
 
 	void rewind(void);
 
+    /**
+     * Flush pending output.  A memory mapped stream has no output and
+     * keeps its current input position.  With write behind, this also
+     * waits for the background write to complete.
+     * @return 0 on success.
+     */
+    int sync(void) __OVERRIDE;
+
+    /**
+     * Write output behind through an asynchronous i/o engine.  When the
+     * output buffer fills it is handed to the engine and a second buffer
+     * is used while the write completes, so the stream does not stall on
+     * slow storage.  This is reset when the stream is closed.
+     * @param engine to write through, or NULL for synchronous writes.
+     */
+    void writeback(AsyncIO *engine);
+
+    /**
+     * Test if the stream is reading through a memory mapping.  This is
+     * false if fsys::MAPPED access fell back to buffered reads.
+     * @return true if memory mapped.
+     */
+    inline bool is_mapped(void) const {
+        return mapped;
+    }
+
     /**
      * Get error flag from last i/o operation.
      * @return last error.
@@ -248,13 +248,30 @@ public:
     bool access(timeout_t timeout = Timer::inf);
 
     /**
-     * Specify hash table size for guard protection.  The default is 1.
-     * This should be called at initialization time from the main thread
-     * of the application before any other threads are created.
-     * @param size of hash table used for guarding.
+     * Specify hash table size for guard protection.  The table is split
+     * into cache line padded stripes, and is otherwise sized from the
+     * number of cpus when the first thread is started.  This should be
+     * called at initialization time from the main thread of the
+     * application before any other threads are created.
+     * @param size of hash table used for guarding, 0 for cpu based.
      */
     static void indexing(unsigned size);
 
+    /**
+     * Get number of stripes in the guard protection table.
+     * @return stripe count.
+     */
+    static unsigned stripes(void);
+
+    /**
+     * Get contention count of a guard protection stripe.  This counts
+     * how often a thread had to wait for the stripe or for an object
+     * guarded through it, and may be used to find hot stripes.
+     * @param stripe to examine.
+     * @return contended lock attempts.
+     */
+    static unsigned contention(unsigned stripe);
+
     /**
      * Release an arbitrary object that has been protected by a rwlock.
      * @param object to release.
@@ -525,13 +542,30 @@ public:
     }
 
     /**
-     * Specify hash table size for guard protection.  The default is 1.
-     * This should be called at initialization time from the main thread
-     * of the application before any other threads are created.
-     * @param size of hash table used for guarding.
+     * Specify hash table size for guard protection.  The table is split
+     * into cache line padded stripes, and is otherwise sized from the
+     * number of cpus when the first thread is started.  This should be
+     * called at initialization time from the main thread of the
+     * application before any other threads are created.
+     * @param size of hash table used for guarding, 0 for cpu based.
      */
     static void indexing(unsigned size);
 
+    /**
+     * Get number of stripes in the guard protection table.
+     * @return stripe count.
+     */
+    static unsigned stripes(void);
+
+    /**
+     * Get contention count of a guard protection stripe.  This counts
+     * how often a thread had to wait for the stripe or for an object
+     * guarded through it, and may be used to find hot stripes.
+     * @param stripe to examine.
+     * @return contended lock attempts.
+     */
+    static unsigned contention(unsigned stripe);
+
     /**
      * Specify pointer/object/resource to guard protect.  This uses a
      * dynamically managed mutex.
@@ -768,6 +802,12 @@ public:
      */
     static size_t cache(void);
 
+    /**
+     * Get number of online processors.
+     * @return cpu count, at least 1.
+     */
+    static unsigned cpus(void);
+
     /**
      * Used to specify scheduling policy for threads above priority "0".
      * Normally we apply static realtime policy SCHED_FIFO (default) or
@@ -56,6 +56,7 @@ namespace ucommon {
 
 class TypeRelease;
 class typeref_guard;
+class typeref_epoch;
 
 /**
  * Smart pointer base class for auto-retained objects.  The underlying
@@ -69,9 +70,11 @@ class __EXPORT TypeRef
 {
 protected:
 	friend class ArrayRef;
+	friend class RingRef;
 	friend class SharedRef;
 	friend class MapRef;
 	friend class TypeRelease;
+	friend class typeref_epoch;
 
 	class Release;
 
@@ -193,6 +196,11 @@ protected:
 	 */
 	void assign(const typeref_guard& ref);
 
+	/**
+	 * Assign from a published typeref without locking.
+	 */
+	void assign(const typeref_epoch& ref);
+
 	/**
 	 * Adjust memory pointer to atomic boundry.
 	 * @param address that was allocated.
@@ -294,12 +302,34 @@ protected:
 	inline size_t size(TypeRef::Counted *obj) {
 		return obj->size;
 	}
+
+	inline unsigned offset(TypeRef::Counted *obj) {
+		return obj->offset;
+	}
 };
 
 extern __EXPORT TypeRelease auto_release;
 extern __EXPORT TypeRelease secure_release;
 extern __EXPORT TypeRelease release_later;
 
+/**
+ * Release containers into per-thread pools.  Containers are served in
+ * whole cache lines from free lists that each thread keeps by size, so
+ * small values neither go through the heap nor are padded to a further
+ * cache line.  Free lists a thread does not need are shared with other
+ * threads, and pooled memory is kept for reuse rather than returned to
+ * the heap.
+ */
+extern __EXPORT TypeRelease pooled_release;
+
+/**
+ * Pooled release for containers confined to the thread that created
+ * them.  Their reference counts are updated without atomic operations,
+ * so they must never be shared with, published to, or released by
+ * another thread.
+ */
+extern __EXPORT TypeRelease local_release;
+
 class __EXPORT typeref_guard : protected TypeRef
 {
 private:
@@ -322,6 +352,72 @@ public:
 	}
 };
 
+/**
+ * A published reference for read-mostly data.  Readers take the current
+ * container without locking, from inside a reader epoch, while a writer
+ * builds a new container and publishes it in one store.  A container that
+ * is replaced is retired rather than released, and the reference that was
+ * published is only dropped once every reader epoch that could still see
+ * it has ended.  Writers are serialized with each other.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT typeref_epoch : protected TypeRef
+{
+private:
+	friend class TypeRef;
+
+	mutable Mutex sync;
+
+	__DELETE_COPY(typeref_epoch);
+
+public:
+	/**
+	 * A reader epoch of the current thread.  While any reader exists,
+	 * containers retired by publishers are kept.  Readers may nest, and
+	 * should be short lived.
+	 * @author David Sugar <dyfet@gnutelephony.org>
+	 */
+	class __EXPORT reader
+	{
+	private:
+		__DELETE_COPY(reader);
+
+		void *slot;
+
+	public:
+		reader();
+
+		~reader();
+	};
+
+	typeref_epoch();
+
+	typeref_epoch(const TypeRef& pointer);
+
+	/**
+	 * Destroy publication.  No readers may still be using it.
+	 */
+	~typeref_epoch();
+
+	/**
+	 * Publish a new container, retiring the one that was published.
+	 * @param pointer to publish.
+	 */
+	void set(const TypeRef& pointer);
+
+	inline typeref_epoch& operator=(const TypeRef& pointer) {
+		set(pointer);
+		return *this;
+	}
+
+	/**
+	 * Release retired containers that no reader epoch can still see.
+	 * This is also done whenever a new container is published.
+	 * @return number of containers released.
+	 */
+	static unsigned reclaim(void);
+};
+
 template<typename T, TypeRelease& R = auto_release>
 class typeref : public TypeRef
 {
@@ -347,10 +443,14 @@ public:
 		TypeRef::assign(global);
 	}
 
+	inline typeref(const typeref_epoch& global) : TypeRef() {
+		TypeRef::assign(global);
+	}
+
 	inline typeref(const typeref& copy) : TypeRef(copy) {}
 
 	inline typeref(const T& object, TypeRelease *ar = &R) : TypeRef() {
-		caddr_t p = R.allocate(sizeof(value));
+		caddr_t p = ar->allocate(sizeof(value));
 		TypeRef::set(new(mem(p)) value(p, object, ar)); 
 	}
 
@@ -388,6 +488,11 @@ public:
 		return *this;
 	}
 
+	inline typeref& operator=(const typeref_epoch& ptr) {
+		TypeRef::assign(ptr);
+		return *this;
+	}
+
 	inline typeref& operator=(const typeref& ptr) {
 		TypeRef::set(ptr);
 		return *this;
@@ -418,7 +523,7 @@ public:
 
 	inline void set(T& object, TypeRelease *pool = &R) {
 		clear();
-		caddr_t p = R.allocate(sizeof(value));
+		caddr_t p = pool->allocate(sizeof(value));
 		TypeRef::set(new(mem(p)) value(p, object, pool));
 	}
 
@@ -481,6 +586,10 @@ public:
 		TypeRef::assign(global);
 	}
 
+	inline typeref(const typeref_epoch& global) : TypeRef() {
+		TypeRef::assign(global);
+	}
+
 	inline explicit typeref(Counted *object) : TypeRef(object) {}
 
 	inline explicit typeref(value *value) : TypeRef(value) {}
@@ -598,6 +707,10 @@ public:
 		TypeRef::assign(global);
 	}
 
+	inline typeref(const typeref_epoch& global) : TypeRef() {
+		TypeRef::assign(global);
+	}
+
 	inline explicit typeref(Counted *object) : TypeRef(object) {}
 
 	const uint8_t *operator*() const;
@@ -93,6 +93,7 @@
 #include <ucommon/string.h>
 #include <ucommon/counter.h>
 #include <ucommon/numbers.h>
+#include <ucommon/hash.h>
 #include <ucommon/reuse.h>
 #include <ucommon/linked.h>
 #include <ucommon/timers.h>
@@ -105,10 +106,12 @@
 #include <ucommon/socket.h>
 #include <ucommon/condition.h>
 #include <ucommon/thread.h>
+#include <ucommon/reactor.h>
 #include <ucommon/arrayref.h>
 #include <ucommon/mapref.h>
 #include <ucommon/shared.h>
 #include <ucommon/fsys.h>
+#include <ucommon/async.h>
 #include <ucommon/temporary.h>
 #include <ucommon/shell.h>
 
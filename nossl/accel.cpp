@@ -0,0 +1,393 @@
+// Copyright (C) 2010-2014 David Sugar, Tycho Softworks.
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+// Cpu specific sha block transforms.  The portable transforms in sha1.cpp
+// and sha2.cpp are replaced by these when secure::init() finds the cpu
+// supports them.  Md5 has no instruction set support, so it is unchanged.
+
+#include "local.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ >= 5 || defined(__clang__))
+#define X86_ACCEL
+#include <immintrin.h>
+#include <cpuid.h>
+#define SHANI_TARGET    __attribute__((target("sha,sse4.1")))
+#define AVX2_TARGET     __attribute__((target("avx2")))
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__) && \
+    (__GNUC__ >= 6 || defined(__clang__))
+#define ARM_ACCEL
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#ifdef  __clang__
+#define CRYPTO_TARGET   __attribute__((target("crypto")))
+#else
+#define CRYPTO_TARGET   __attribute__((target("+crypto")))
+#endif
+#endif
+
+#ifdef  X86_ACCEL
+
+// SHA-1 with the x86 sha extensions.  Each group of four rounds also
+// advances the message schedule for the groups that follow it.
+#define SHA1_GROUP(e, f, m0, m1, m2, m3, fn) \
+    e = _mm_sha1nexte_epu32(e, m0); \
+    f = abcd; \
+    m1 = _mm_sha1msg2_epu32(m1, m0); \
+    abcd = _mm_sha1rnds4_epu32(abcd, e, fn); \
+    m3 = _mm_sha1msg1_epu32(m3, m0); \
+    m2 = _mm_xor_si128(m2, m0);
+
+SHANI_TARGET static void sha1_shani(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd, e0, e1, m0, m1, m2, m3, abcd_save, e0_save;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1b);
+    e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+    while(blocks--) {
+        abcd_save = abcd;
+        e0_save = e0;
+
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data)), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        SHA1_GROUP(e1, e0, m3, m0, m1, m2, 0);
+        SHA1_GROUP(e0, e1, m0, m1, m2, m3, 0);
+        SHA1_GROUP(e1, e0, m1, m2, m3, m0, 1);
+        SHA1_GROUP(e0, e1, m2, m3, m0, m1, 1);
+        SHA1_GROUP(e1, e0, m3, m0, m1, m2, 1);
+        SHA1_GROUP(e0, e1, m0, m1, m2, m3, 1);
+        SHA1_GROUP(e1, e0, m1, m2, m3, m0, 1);
+        SHA1_GROUP(e0, e1, m2, m3, m0, m1, 2);
+        SHA1_GROUP(e1, e0, m3, m0, m1, m2, 2);
+        SHA1_GROUP(e0, e1, m0, m1, m2, m3, 2);
+        SHA1_GROUP(e1, e0, m1, m2, m3, m0, 2);
+        SHA1_GROUP(e0, e1, m2, m3, m0, m1, 2);
+        SHA1_GROUP(e1, e0, m3, m0, m1, m2, 3);
+        SHA1_GROUP(e0, e1, m0, m1, m2, m3, 3);
+        SHA1_GROUP(e1, e0, m1, m2, m3, m0, 3);
+        SHA1_GROUP(e0, e1, m2, m3, m0, m1, 3);
+        SHA1_GROUP(e1, e0, m3, m0, m1, m2, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+        data += SHA1_BLOCK_LENGTH;
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+// SHA-256 with the x86 sha extensions.  The mask either byte swaps
+// message bytes into words or leaves words already in host order.
+SHANI_TARGET static inline void sha256_shani(uint_32t hash[8], const void *data, unsigned long blocks, __m128i mask)
+{
+    const __m128i *mp = (const __m128i *)data;
+    __m128i s0, s1, msg, tmp, w0, w1, w2, w3, abef, cdgh;
+    unsigned i;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&hash[0]), 0xb1);
+    s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&hash[4]), 0x1b);
+    s0 = _mm_alignr_epi8(tmp, s1, 8);
+    s1 = _mm_blend_epi16(s1, tmp, 0xf0);
+
+    while(blocks--) {
+        abef = s0;
+        cdgh = s1;
+
+        w0 = _mm_shuffle_epi8(_mm_loadu_si128(mp++), mask);
+        w1 = _mm_shuffle_epi8(_mm_loadu_si128(mp++), mask);
+        w2 = _mm_shuffle_epi8(_mm_loadu_si128(mp++), mask);
+        w3 = _mm_shuffle_epi8(_mm_loadu_si128(mp++), mask);
+
+        for(i = 0; i < 64; i += 4) {
+            msg = _mm_add_epi32(w0, _mm_loadu_si128((const __m128i *)&k256[i]));
+            s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+            s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0e));
+            tmp = _mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4));
+            w0 = w1;
+            w1 = w2;
+            w2 = w3;
+            w3 = _mm_sha256msg2_epu32(tmp, w2);
+        }
+
+        s0 = _mm_add_epi32(s0, abef);
+        s1 = _mm_add_epi32(s1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(s0, 0x1b);
+    s1 = _mm_shuffle_epi32(s1, 0xb1);
+    _mm_storeu_si128((__m128i *)&hash[0], _mm_blend_epi16(tmp, s1, 0xf0));
+    _mm_storeu_si128((__m128i *)&hash[4], _mm_alignr_epi8(s1, tmp, 8));
+}
+
+SHANI_TARGET static void sha256_shani_words(uint_32t hash[8], uint_32t words[16])
+{
+    sha256_shani(hash, words, 1,
+        _mm_set_epi64x(0x0f0e0d0c0b0a0908ULL, 0x0706050403020100ULL));
+}
+
+SHANI_TARGET static void sha256_shani_bytes(uint_32t hash[8], const unsigned char data[], unsigned long blocks)
+{
+    sha256_shani(hash, data, blocks,
+        _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+}
+
+// SHA-256 of eight independent messages at once, one message in each
+// 32 bit lane of the avx2 registers.  This pays off for many short
+// messages on cpus without the sha extensions.
+#define ROR8(x, n)  _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+
+static inline uint_32t load_be32(const unsigned char *p)
+{
+    return ((uint_32t)p[0] << 24) | ((uint_32t)p[1] << 16) | ((uint_32t)p[2] << 8) | p[3];
+}
+
+AVX2_TARGET static void sha256_avx2(uint_32t hash[8][8], const unsigned char *data[8])
+{
+    __m256i w[16], v[8], t1, t2;
+    unsigned i;
+
+    for(i = 0; i < 16; ++i)
+        w[i] = _mm256_set_epi32(
+            (int)load_be32(data[7] + i * 4), (int)load_be32(data[6] + i * 4),
+            (int)load_be32(data[5] + i * 4), (int)load_be32(data[4] + i * 4),
+            (int)load_be32(data[3] + i * 4), (int)load_be32(data[2] + i * 4),
+            (int)load_be32(data[1] + i * 4), (int)load_be32(data[0] + i * 4));
+
+    for(i = 0; i < 8; ++i)
+        v[i] = _mm256_loadu_si256((const __m256i *)hash[i]);
+
+    for(i = 0; i < 64; ++i) {
+        if(i > 15)
+            w[i & 15] = _mm256_add_epi32(
+                _mm256_add_epi32(w[i & 15], w[(i + 9) & 15]),
+                _mm256_add_epi32(
+                    XOR3(ROR8(w[(i + 1) & 15], 7), ROR8(w[(i + 1) & 15], 18),
+                        _mm256_srli_epi32(w[(i + 1) & 15], 3)),
+                    XOR3(ROR8(w[(i + 14) & 15], 17), ROR8(w[(i + 14) & 15], 19),
+                        _mm256_srli_epi32(w[(i + 14) & 15], 10))));
+
+        t1 = _mm256_add_epi32(
+            _mm256_add_epi32(v[7], XOR3(ROR8(v[4], 6), ROR8(v[4], 11), ROR8(v[4], 25))),
+            _mm256_add_epi32(
+                _mm256_xor_si256(_mm256_and_si256(v[4], v[5]), _mm256_andnot_si256(v[4], v[6])),
+                _mm256_add_epi32(_mm256_set1_epi32((int)k256[i]), w[i & 15])));
+        t2 = _mm256_add_epi32(
+            XOR3(ROR8(v[0], 2), ROR8(v[0], 13), ROR8(v[0], 22)),
+            _mm256_or_si256(_mm256_and_si256(v[0], v[1]),
+                _mm256_and_si256(v[2], _mm256_or_si256(v[0], v[1]))));
+
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = _mm256_add_epi32(v[3], t1);
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = _mm256_add_epi32(t1, t2);
+    }
+
+    for(i = 0; i < 8; ++i)
+        _mm256_storeu_si256((__m256i *)hash[i],
+            _mm256_add_epi32(v[i], _mm256_loadu_si256((const __m256i *)hash[i])));
+}
+
+static void x86_accel(void)
+{
+    unsigned eax, ebx, ecx, edx;
+    unsigned features, extended = 0;
+    bool avx = false;
+
+    if(!__get_cpuid(1, &eax, &ebx, &features, &edx))
+        return;
+
+    if(__get_cpuid_max(0, NULL) >= 7)
+        __cpuid_count(7, 0, eax, extended, ecx, edx);
+
+    // avx2 also needs the os to save the ymm registers
+    if((features & bit_OSXSAVE) && (features & bit_AVX)) {
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        avx = (eax & 6) == 6;
+    }
+
+    if((extended & bit_SHA) && (features & bit_SSE4_1)) {
+        sha1_blocks = sha1_shani;
+        sha256_words = sha256_shani_words;
+        sha256_bytes = sha256_shani_bytes;
+    }
+    else if(avx && (extended & bit_AVX2))
+        sha256_lanes = sha256_avx2;
+}
+
+#endif
+
+#ifdef  ARM_ACCEL
+
+// SHA-1 and SHA-256 with the armv8 crypto extensions.
+
+static const uint32_t k160[4] = {
+    0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6};
+
+CRYPTO_TARGET static void sha1_armv8(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+    uint32x4_t abcd, abcd_save, tmp, w0, w1, w2, w3, w4;
+    uint32_t e0, e1, e0_save;
+    unsigned i;
+
+    abcd = vld1q_u32(state);
+    e0 = state[4];
+
+    while(blocks--) {
+        abcd_save = abcd;
+        e0_save = e0;
+
+        w0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+        w1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+        w2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+        w3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+        for(i = 0; i < 20; ++i) {
+            tmp = vaddq_u32(w0, vdupq_n_u32(k160[i / 5]));
+            e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+            if(i < 5)
+                abcd = vsha1cq_u32(abcd, e0, tmp);
+            else if(i < 10 || i > 14)
+                abcd = vsha1pq_u32(abcd, e0, tmp);
+            else
+                abcd = vsha1mq_u32(abcd, e0, tmp);
+            e0 = e1;
+            w4 = vsha1su1q_u32(vsha1su0q_u32(w0, w1, w2), w3);
+            w0 = w1;
+            w1 = w2;
+            w2 = w3;
+            w3 = w4;
+        }
+
+        abcd = vaddq_u32(abcd, abcd_save);
+        e0 += e0_save;
+        data += SHA1_BLOCK_LENGTH;
+    }
+
+    vst1q_u32(state, abcd);
+    state[4] = e0;
+}
+
+CRYPTO_TARGET static inline void sha256_armv8(uint_32t hash[8], const unsigned char *data, unsigned long blocks, bool swap)
+{
+    uint32x4_t s0, s1, save0, save1, tmp, w[5];
+    unsigned i;
+
+    s0 = vld1q_u32(&hash[0]);
+    s1 = vld1q_u32(&hash[4]);
+
+    while(blocks--) {
+        save0 = s0;
+        save1 = s1;
+
+        for(i = 0; i < 4; ++i) {
+            if(swap)
+                w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+            else
+                w[i] = vreinterpretq_u32_u8(vld1q_u8(data + i * 16));
+        }
+
+        for(i = 0; i < 64; i += 4) {
+            tmp = vaddq_u32(w[0], vld1q_u32(&k256[i]));
+            w[4] = s0;
+            s0 = vsha256hq_u32(s0, s1, tmp);
+            s1 = vsha256h2q_u32(s1, w[4], tmp);
+            w[4] = vsha256su1q_u32(vsha256su0q_u32(w[0], w[1]), w[2], w[3]);
+            w[0] = w[1];
+            w[1] = w[2];
+            w[2] = w[3];
+            w[3] = w[4];
+        }
+
+        s0 = vaddq_u32(s0, save0);
+        s1 = vaddq_u32(s1, save1);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    vst1q_u32(&hash[0], s0);
+    vst1q_u32(&hash[4], s1);
+}
+
+CRYPTO_TARGET static void sha256_armv8_words(uint_32t hash[8], uint_32t words[16])
+{
+    sha256_armv8(hash, (const unsigned char *)words, 1, false);
+}
+
+CRYPTO_TARGET static void sha256_armv8_bytes(uint_32t hash[8], const unsigned char data[], unsigned long blocks)
+{
+    sha256_armv8(hash, data, blocks, true);
+}
+
+static void arm_accel(void)
+{
+    unsigned long caps = getauxval(AT_HWCAP);
+
+    if(caps & HWCAP_SHA1)
+        sha1_blocks = sha1_armv8;
+
+    if(caps & HWCAP_SHA2) {
+        sha256_words = sha256_armv8_words;
+        sha256_bytes = sha256_armv8_bytes;
+    }
+}
+
+#endif
+
+void sha_accel(void)
+{
+    static bool selected = false;
+
+    if(selected)
+        return;
+
+    selected = true;
+
+#if defined(X86_ACCEL)
+    x86_accel();
+#elif defined(ARM_ACCEL)
+    arm_accel();
+#endif
+}
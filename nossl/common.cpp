@@ -392,6 +392,17 @@ HMAC::HMAC(const char *digest, const secure::keybytes& key)
     set(digest, key);
 }
 
+HMAC::HMAC(const Key& key)
+{
+    context = NULL;
+    bufsize = 0;
+    hmactype = NULL;
+    hmacid = 0;
+    textbuf[0] = 0;
+
+    set(key);
+}
+
 HMAC::~HMAC()
 {
     release();
@@ -406,6 +417,15 @@ secure::string HMAC::str(void)
     if(!bufsize)
         return secure::string();
 
+    // text is only formatted when asked for
+    if(!textbuf[0]) {
+        unsigned count = 0;
+        while(count < bufsize) {
+            snprintf(textbuf + (count * 2), 3, "%2.2x", buffer[count]);
+            ++count;
+        }
+    }
+
     return secure::string(textbuf);
 }
 
@@ -420,6 +440,27 @@ secure::keybytes HMAC::key(void)
     return secure::keybytes(buffer, bufsize);
 }
 
+HMAC::Key::Key()
+{
+    context = NULL;
+    keytype = NULL;
+    keyid = 0;
+}
+
+HMAC::Key::Key(const char *digest, const secure::keybytes& key)
+{
+    context = NULL;
+    keytype = NULL;
+    keyid = 0;
+
+    set(digest, key);
+}
+
+HMAC::Key::~Key()
+{
+    clear();
+}
+
 Cipher::Key::Key(const char *cipher)
 {
     hashtype = algotype = NULL;
@@ -146,6 +146,68 @@ void Digest::reset(void)
     bufsize = 0;
 }
 
+unsigned Digest::batch(const char *type, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **digests)
+{
+    size_t pos;
+    unsigned index, total;
+
+    if(eq_case(type, "md5")) {
+        MD5_CTX ctx;
+        for(pos = 0; pos < count; ++pos) {
+            MD5Init(&ctx);
+            MD5Update(&ctx, data[pos], size[pos]);
+            MD5Final(digests[pos], &ctx);
+        }
+        return 16;
+    }
+
+    if(eq_case(type, "sha") || eq_case(type, "sha1")) {
+        SHA1_CTX ctx;
+        for(pos = 0; pos < count; ++pos) {
+            SHA1Init(&ctx);
+            SHA1Update(&ctx, data[pos], size[pos]);
+            SHA1Final(digests[pos], &ctx);
+        }
+        return 20;
+    }
+
+    if(eq_case(type, "sha2") || eq_case(type, "sha256")) {
+        sha256_ctx ctx[BATCH_COUNT];
+        sha256_ctx *cp[BATCH_COUNT];
+        const unsigned char *dp[BATCH_COUNT];
+        unsigned long lp[BATCH_COUNT];
+
+        // sha256_many can hash the messages of a pass in parallel
+        for(pos = 0; pos < count; pos += total) {
+            total = BATCH_COUNT;
+            if(count - pos < total)
+                total = (unsigned)(count - pos);
+            for(index = 0; index < total; ++index) {
+                sha256_begin(&ctx[index]);
+                cp[index] = &ctx[index];
+                dp[index] = data[pos + index];
+                lp[index] = (unsigned long)size[pos + index];
+            }
+            sha256_many(&digests[pos], dp, lp, cp, total);
+        }
+        memset(ctx, 0, sizeof(ctx));
+        return 32;
+    }
+
+    if(eq_case(type, "sha384")) {
+        sha384_ctx ctx;
+        for(pos = 0; pos < count; ++pos) {
+            sha384_begin(&ctx);
+            sha384_hash(data[pos], size[pos], &ctx);
+            sha384_end(digests[pos], &ctx);
+        }
+        memset(&ctx, 0, sizeof(ctx));
+        return 48;
+    }
+
+    return 0;
+}
+
 void Digest::recycle(bool bin)
 {
     unsigned size = bufsize;
@@ -273,6 +273,85 @@ void HMAC::set(const char *digest, const secure::keybytes& key)
     }
 }
 
+void HMAC::set(const Key& key)
+{
+    if(!key.context || !key.keytype) {
+        release();
+        return;
+    }
+
+    char id = *((const char *)key.keytype);
+
+    // reuse a context of the same type left from a prior message
+    if(!context || !hmactype || *((char *)hmactype) != id) {
+        release();
+        switch(id) {
+        case '2':
+            context = new hmacSha256Context;
+            break;
+        case '3':
+            context = new hmacSha384Context;
+            break;
+        default:
+            return;
+        }
+        hmactype = key.keytype;
+    }
+
+    switch(id) {
+    case '2':
+        memcpy(context, key.context, sizeof(hmacSha256Context));
+        break;
+    case '3':
+        memcpy(context, key.context, sizeof(hmacSha384Context));
+        break;
+    }
+
+    bufsize = 0;
+    textbuf[0] = 0;
+}
+
+void HMAC::Key::set(const char *digest, const secure::keybytes& key)
+{
+    clear();
+
+    size_t len = key.size() / 8;
+    if(!len)
+        return;
+
+    if(eq_case(digest, "sha256")) {
+        keytype = "2";
+        context = new hmacSha256Context;
+        hmacSha256Init((hmacSha256Context*)context, (const uint8_t *)*key, len);
+    }
+    else if(eq_case(digest, "sha384")) {
+        keytype = "3";
+        context = new hmacSha384Context;
+        hmacSha384Init((hmacSha384Context*)context, (const uint8_t *)*key, len);
+    }
+}
+
+void HMAC::Key::clear(void)
+{
+    if(context && keytype) {
+        switch(*((char *)keytype)) {
+        case '2':
+            memset(context, 0, sizeof(hmacSha256Context));
+            delete (hmacSha256Context *)context;
+            break;
+        case '3':
+            memset(context, 0, sizeof(hmacSha384Context));
+            delete (hmacSha384Context *)context;
+            break;
+        default:
+            break;
+        }
+    }
+
+    keytype = NULL;
+    context = NULL;
+}
+
 void HMAC::release(void)
 {
     if(context && hmactype) {
@@ -313,6 +392,70 @@ bool HMAC::put(const void *address, size_t size)
     }
 }
 
+unsigned HMAC::batch(const char *digest, const secure::keybytes& key, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **results)
+{
+    size_t pos;
+    size_t len = key.size() / 8;
+    unsigned index, total;
+
+    if(!len)
+        return 0;
+
+    if(eq_case(digest, "sha256")) {
+        hmacSha256Context hmac;
+        sha256_ctx ctx[BATCH_COUNT];
+        sha256_ctx *cp[BATCH_COUNT];
+        const unsigned char *dp[BATCH_COUNT];
+        unsigned long lp[BATCH_COUNT];
+        uint8_t inner[BATCH_COUNT][SHA256_DIGEST_SIZE];
+        uint8_t *ip[BATCH_COUNT];
+
+        hmacSha256Init(&hmac, (const uint8_t *)*key, len);
+
+        // inner hashes of a pass, then outer hashes of their digests
+        for(pos = 0; pos < count; pos += total) {
+            total = BATCH_COUNT;
+            if(count - pos < total)
+                total = (unsigned)(count - pos);
+            for(index = 0; index < total; ++index) {
+                memcpy(&ctx[index], &hmac.innerCtx, sizeof(sha256_ctx));
+                cp[index] = &ctx[index];
+                dp[index] = data[pos + index];
+                lp[index] = (unsigned long)size[pos + index];
+                ip[index] = inner[index];
+            }
+            sha256_many(ip, dp, lp, cp, total);
+            for(index = 0; index < total; ++index) {
+                memcpy(&ctx[index], &hmac.outerCtx, sizeof(sha256_ctx));
+                dp[index] = inner[index];
+                lp[index] = SHA256_DIGEST_SIZE;
+            }
+            sha256_many(&results[pos], dp, lp, cp, total);
+        }
+
+        memset(&hmac, 0, sizeof(hmac));
+        memset(ctx, 0, sizeof(ctx));
+        memset(inner, 0, sizeof(inner));
+        return SHA256_DIGEST_SIZE;
+    }
+
+    if(eq_case(digest, "sha384")) {
+        hmacSha384Context hmac;
+
+        hmacSha384Init(&hmac, (const uint8_t *)*key, len);
+        for(pos = 0; pos < count; ++pos) {
+            memcpy(&hmac.ctx, &hmac.innerCtx, sizeof(sha384_ctx));
+            hmacSha384Update(&hmac, data[pos], size[pos]);
+            hmacSha384Final(&hmac, results[pos]);
+        }
+
+        memset(&hmac, 0, sizeof(hmac));
+        return SHA384_DIGEST_SIZE;
+    }
+
+    return 0;
+}
+
 const uint8_t *HMAC::get(void)
 {
     if(bufsize)
@@ -324,21 +467,17 @@ const uint8_t *HMAC::get(void)
     switch(*((char *)hmactype)) {
     case '2':
         hmacSha256Final((hmacSha256Context *)context, buffer);
-        bufsize = SHA256_BLOCK_SIZE;
+        bufsize = SHA256_DIGEST_SIZE;
         break;
     case '3':
         hmacSha384Final((hmacSha384Context *)context, buffer);
-        bufsize = SHA384_BLOCK_SIZE;
+        bufsize = SHA384_DIGEST_SIZE;
         break;
     default:
         return NULL;
     }
 
-    size_t count = 0;
-    while(count < bufsize) {
-        snprintf(textbuf + (count * 2), 3, "%2.2x", buffer[count]);
-        ++count;
-    }
+    textbuf[0] = 0;
     return buffer;
 }
 
@@ -29,6 +29,9 @@
 #include <wincrypt.h>
 #endif
 
+// messages hashed together by each pass of a batch digest
+#define BATCH_COUNT 32
+
 namespace ucommon {
 #ifdef  _MSWINDOWS_
 extern HCRYPTPROV __handle;
@@ -36,6 +36,7 @@ bool secure::init(void)
 {
     Thread::init();
     Socket::init();
+    sha_accel();
 
 #ifdef  _MSWINDOWS_
     if(__handle != (HCRYPTPROV)NULL)
@@ -59,7 +60,7 @@ secure::server_t secure::server(const char *cert, const char *key)
     return NULL;
 }
 
-secure::client_t secure::client(const char *ca)
+secure::client_t secure::client(const char *ca, const char *paths)
 {
     return NULL;
 }
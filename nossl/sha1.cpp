@@ -158,6 +158,17 @@ SHA1Transform(uint32_t state[5], const uint8_t buffer[SHA1_BLOCK_LENGTH])
     a = b = c = d = e = 0;
 }
 
+static void
+SHA1Blocks(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+    while (blocks--) {
+        SHA1Transform(state, data);
+        data += SHA1_BLOCK_LENGTH;
+    }
+}
+
+sha1_blocks_t sha1_blocks = SHA1Blocks;
+
 
 /*
  * SHA1Init - Initialize new context
@@ -188,9 +199,12 @@ SHA1Update(SHA1_CTX *context, const uint8_t *data, size_t len)
     context->count += (len << 3);
     if ((j + len) > 63) {
         (void)memcpy(&context->buffer[j], data, (i = 64-j));
-        SHA1Transform(context->state, context->buffer);
-        for ( ; i + 63 < len; i += 64)
-            SHA1Transform(context->state, (uint8_t *)&data[i]);
+        (*sha1_blocks)(context->state, context->buffer, 1);
+        if (len - i > 63) {
+            j = (len - i) >> 6;
+            (*sha1_blocks)(context->state, &data[i], j);
+            i += j << 6;
+        }
         j = 0;
     } else {
         i = 0;
@@ -25,6 +25,12 @@ void SHA1Transform(uint32_t [5], const uint8_t [SHA1_BLOCK_LENGTH]);
 void SHA1Update(SHA1_CTX *, const uint8_t *, size_t);
 void SHA1Final(uint8_t [SHA1_DIGEST_LENGTH], SHA1_CTX *);
 
+/*
+ * Block transform used by SHA1Update, selected at runtime by sha_accel()
+ */
+typedef void (*sha1_blocks_t)(uint32_t [5], const uint8_t *, size_t);
+extern sha1_blocks_t sha1_blocks;
+
 #define HTONDIGEST(x) do {                                              \
         x[0] = htonl(x[0]);                                             \
         x[1] = htonl(x[1]);                                             \
@@ -189,13 +189,13 @@ const uint_32t k256[64] =
 /* in the ORIGINAL byte stream will go into the high end of */
 /* words on BOTH big and little endian systems              */
 
-VOID_RETURN sha256_compile(sha256_ctx ctx[1])
+static void sha256_block(uint_32t hash[8], uint_32t words[16])
 {
 #if !defined(UNROLL_SHA2)
 
-    uint_32t j, *p = ctx->wbuf, v[8];
+    uint_32t j, *p = words, v[8];
 
-    memcpy(v, ctx->hash, 8 * sizeof(uint_32t));
+    memcpy(v, hash, 8 * sizeof(uint_32t));
 
     for(j = 0; j < 64; j += 16)
     {
@@ -209,19 +209,19 @@ VOID_RETURN sha256_compile(sha256_ctx ctx[1])
         v_cycle(14, j); v_cycle(15, j);
     }
 
-    ctx->hash[0] += v[0]; ctx->hash[1] += v[1];
-    ctx->hash[2] += v[2]; ctx->hash[3] += v[3];
-    ctx->hash[4] += v[4]; ctx->hash[5] += v[5];
-    ctx->hash[6] += v[6]; ctx->hash[7] += v[7];
+    hash[0] += v[0]; hash[1] += v[1];
+    hash[2] += v[2]; hash[3] += v[3];
+    hash[4] += v[4]; hash[5] += v[5];
+    hash[6] += v[6]; hash[7] += v[7];
 
 #else
 
-    uint_32t *p = ctx->wbuf,v0,v1,v2,v3,v4,v5,v6,v7;
+    uint_32t *p = words,v0,v1,v2,v3,v4,v5,v6,v7;
 
-    v0 = ctx->hash[0]; v1 = ctx->hash[1];
-    v2 = ctx->hash[2]; v3 = ctx->hash[3];
-    v4 = ctx->hash[4]; v5 = ctx->hash[5];
-    v6 = ctx->hash[6]; v7 = ctx->hash[7];
+    v0 = hash[0]; v1 = hash[1];
+    v2 = hash[2]; v3 = hash[3];
+    v4 = hash[4]; v5 = hash[5];
+    v6 = hash[6]; v7 = hash[7];
 
     one_cycle(0,1,2,3,4,5,6,7,k256[ 0],p[ 0]);
     one_cycle(7,0,1,2,3,4,5,6,k256[ 1],p[ 1]);
@@ -291,13 +291,36 @@ VOID_RETURN sha256_compile(sha256_ctx ctx[1])
     one_cycle(2,3,4,5,6,7,0,1,k256[62],hf(14));
     one_cycle(1,2,3,4,5,6,7,0,k256[63],hf(15));
 
-    ctx->hash[0] += v0; ctx->hash[1] += v1;
-    ctx->hash[2] += v2; ctx->hash[3] += v3;
-    ctx->hash[4] += v4; ctx->hash[5] += v5;
-    ctx->hash[6] += v6; ctx->hash[7] += v7;
+    hash[0] += v0; hash[1] += v1;
+    hash[2] += v2; hash[3] += v3;
+    hash[4] += v4; hash[5] += v5;
+    hash[6] += v6; hash[7] += v7;
 #endif
 }
 
+/* compile whole blocks of message bytes with the portable transform */
+
+static void sha256_blocks(uint_32t hash[8], const unsigned char data[], unsigned long blocks)
+{   uint_32t w[16];
+
+    while(blocks--)
+    {
+        memcpy(w, data, SHA256_BLOCK_SIZE);
+        bsw_32(w, SHA256_BLOCK_SIZE >> 2)
+        sha256_block(hash, w);
+        data += SHA256_BLOCK_SIZE;
+    }
+}
+
+sha256_words_t sha256_words = sha256_block;
+sha256_bytes_t sha256_bytes = sha256_blocks;
+sha256_lanes_t sha256_lanes = 0;
+
+VOID_RETURN sha256_compile(sha256_ctx ctx[1])
+{
+    (*sha256_words)(ctx->hash, ctx->wbuf);
+}
+
 /* SHA256 hash data in an array of bytes into hash buffer   */
 /* and call the hash_compile function as required.          */
 
@@ -309,7 +332,7 @@ VOID_RETURN sha256_hash(const unsigned char data[], unsigned long len, sha256_ct
     if((ctx->count[0] += len) < len)
         ++(ctx->count[1]);
 
-    while(len >= space)     /* tranfer whole blocks while possible  */
+    if(pos && len >= space) /* complete a partly filled block       */
     {
         memcpy(((unsigned char*)ctx->wbuf) + pos, sp, space);
         sp += space; len -= space; space = SHA256_BLOCK_SIZE; pos = 0;
@@ -317,6 +340,12 @@ VOID_RETURN sha256_hash(const unsigned char data[], unsigned long len, sha256_ct
         sha256_compile(ctx);
     }
 
+    if(len >= SHA256_BLOCK_SIZE) /* compile whole blocks in place   */
+    {
+        (*sha256_bytes)(ctx->hash, sp, len / SHA256_BLOCK_SIZE);
+        sp += len & ~(unsigned long)SHA256_MASK; len &= SHA256_MASK;
+    }
+
     memcpy(((unsigned char*)ctx->wbuf) + pos, sp, len);
 }
 
@@ -424,6 +453,128 @@ VOID_RETURN sha256(unsigned char hval[], const unsigned char data[], unsigned lo
     sha_end1(hval, cx, SHA256_DIGEST_SIZE);
 }
 
+/* a message being hashed in one lane of the lanes transform; whole */
+/* blocks are read in place and the final partial block and padding */
+/* are assembled in the tail buffer                                 */
+
+typedef struct
+{   const unsigned char *sp, *tp;
+    unsigned long blocks;
+    unsigned char *hval;
+    unsigned int tails;
+    unsigned char tail[2 * SHA256_BLOCK_SIZE];
+} sha256_lane;
+
+static void lane_begin(sha256_lane *ln, uint_32t hash[8][8], unsigned int lane,
+            unsigned char *hval, const unsigned char *sp, unsigned long len, sha256_ctx cx[1])
+{   uint_32t i = (uint_32t)(cx->count[0] & SHA256_MASK), lo, hi;
+    unsigned long n;
+
+    if(i)   /* complete the block already held by the context       */
+    {
+        n = SHA256_BLOCK_SIZE - i;
+        if(n > len)
+            n = len;
+        sha256_hash(sp, n, cx);
+        sp += n; len -= n;
+        i = (uint_32t)(cx->count[0] & SHA256_MASK);
+    }
+
+    lo = cx->count[0] + (uint_32t)len;
+    hi = cx->count[1] + (lo < (uint_32t)len);
+
+    ln->sp = sp;
+    ln->blocks = len / SHA256_BLOCK_SIZE;
+    ln->hval = hval;
+    len &= SHA256_MASK;
+
+    memcpy(ln->tail, cx->wbuf, i);
+    memcpy(ln->tail + i, sp + ln->blocks * SHA256_BLOCK_SIZE, len);
+    i += (uint_32t)len;
+    ln->tail[i++] = 0x80;
+    ln->tails = (i > SHA256_BLOCK_SIZE - 8) ? 2 : 1;
+    ln->tp = ln->tail;
+    memset(ln->tail + i, 0, ln->tails * SHA256_BLOCK_SIZE - i);
+
+    hi = (hi << 3) | (lo >> 29);
+    lo <<= 3;
+    for(i = 0; i < 4; ++i)
+    {
+        ln->tail[ln->tails * SHA256_BLOCK_SIZE - 8 + i] = (unsigned char)(hi >> (24 - 8 * i));
+        ln->tail[ln->tails * SHA256_BLOCK_SIZE - 4 + i] = (unsigned char)(lo >> (24 - 8 * i));
+    }
+
+    for(i = 0; i < 8; ++i)
+        hash[i][lane] = cx->hash[i];
+}
+
+VOID_RETURN sha256_many(unsigned char *hval[], const unsigned char *data[], const unsigned long len[], sha256_ctx *ctx[], unsigned long count)
+{   sha256_lane ln[8];
+    uint_32t hash[8][8];
+    const unsigned char *bp[8];
+    unsigned char idle[SHA256_BLOCK_SIZE];
+    unsigned long next = 0;
+    unsigned int i, j, active;
+
+    if(!sha256_lanes)
+    {
+        for(next = 0; next < count; ++next)
+        {
+            sha256_hash(data[next], len[next], ctx[next]);
+            sha_end1(hval[next], ctx[next], SHA256_DIGEST_SIZE);
+        }
+        return;
+    }
+
+    memset(idle, 0, sizeof(idle));
+    for(i = 0; i < 8; ++i)
+        ln[i].hval = 0;
+
+    for(;;)
+    {
+        active = 0;
+        for(i = 0; i < 8; ++i)
+        {
+            if(!ln[i].hval && next < count)
+            {
+                lane_begin(&ln[i], hash, i, hval[next], data[next], len[next], ctx[next]);
+                ++next;
+            }
+
+            if(!ln[i].hval)
+                bp[i] = idle;
+            else if(ln[i].blocks)
+            {
+                bp[i] = ln[i].sp;
+                ln[i].sp += SHA256_BLOCK_SIZE;
+                --ln[i].blocks;
+                ++active;
+            }
+            else
+            {
+                bp[i] = ln[i].tp;
+                ln[i].tp += SHA256_BLOCK_SIZE;
+                --ln[i].tails;
+                ++active;
+            }
+        }
+
+        if(!active)
+            break;
+
+        (*sha256_lanes)(hash, bp);
+
+        for(i = 0; i < 8; ++i)
+        {
+            if(!ln[i].hval || ln[i].blocks || ln[i].tails)
+                continue;
+            for(j = 0; j < SHA256_DIGEST_SIZE; ++j)
+                ln[i].hval[j] = (unsigned char)(hash[j >> 2][i] >> (8 * (~j & 3)));
+            ln[i].hval = 0;
+        }
+    }
+}
+
 #endif
 
 #if defined(SHA_384) || defined(SHA_512)
@@ -78,6 +78,24 @@ typedef sha256_ctx  sha224_ctx;
 
 VOID_RETURN sha256_compile(sha256_ctx ctx[1]);
 
+/* SHA256 block transforms.  These start out as the portable code   */
+/* and may be replaced with cpu specific kernels by sha_accel().    */
+/* The words form compiles one block already converted to host word */
+/* order, the bytes form compiles whole blocks of message bytes,    */
+/* and the lanes form, if present, compiles one block for each of   */
+/* eight independent messages with the hash values held by word.    */
+
+typedef void (*sha256_words_t)(uint_32t hash[8], uint_32t words[16]);
+typedef void (*sha256_bytes_t)(uint_32t hash[8], const unsigned char data[], unsigned long blocks);
+typedef void (*sha256_lanes_t)(uint_32t hash[8][8], const unsigned char *data[8]);
+
+extern const uint_32t k256[64];
+extern sha256_words_t sha256_words;
+extern sha256_bytes_t sha256_bytes;
+extern sha256_lanes_t sha256_lanes;
+
+void sha_accel(void);
+
 VOID_RETURN sha224_begin(sha224_ctx ctx[1]);
 #define sha224_hash sha256_hash
 VOID_RETURN sha224_end(unsigned char hval[], sha224_ctx ctx[1]);
@@ -88,6 +106,10 @@ VOID_RETURN sha256_hash(const unsigned char data[], unsigned long len, sha256_ct
 VOID_RETURN sha256_end(unsigned char hval[], sha256_ctx ctx[1]);
 VOID_RETURN sha256(unsigned char hval[], const unsigned char data[], unsigned long len);
 
+/* hash the remaining data of many independent messages and return  */
+/* their digests, using the lanes transform where it is available   */
+VOID_RETURN sha256_many(unsigned char *hval[], const unsigned char *data[], const unsigned long len[], sha256_ctx *ctx[], unsigned long count);
+
 #ifndef SHA_64BIT
 
 typedef struct
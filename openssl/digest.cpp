@@ -110,6 +110,34 @@ buffer[count]);
 
 }
 
+unsigned Digest::batch(const char *type, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **digests)
+{
+    EVP_MD_CTX ctx;
+    unsigned len = 0;
+    size_t pos;
+
+    secure::init();
+
+    // never use sha0
+    if(eq_case(type, "sha") || eq_case(type, "sha160"))
+        type = "sha1";
+
+    const EVP_MD *md = EVP_get_digestbyname(type);
+    if(!md)
+        return 0;
+
+    // one context is reinitialized for each message
+    EVP_MD_CTX_init(&ctx);
+    for(pos = 0; pos < count; ++pos) {
+        EVP_DigestInit_ex(&ctx, md, NULL);
+        EVP_DigestUpdate(&ctx, data[pos], size[pos]);
+        EVP_DigestFinal_ex(&ctx, digests[pos], &len);
+    }
+    EVP_MD_CTX_cleanup(&ctx);
+
+    return (unsigned)EVP_MD_size(md);
+}
+
 const uint8_t *Digest::get(void)
 {
     unsigned count = 0;
@@ -41,6 +41,47 @@ void HMAC::set(const char *digest, const secure::keybytes& key)
     }
 }
 
+void HMAC::set(const Key& key)
+{
+    release();
+
+    if(!key.context)
+        return;
+
+    hmactype = key.keytype;
+    context = new ::HMAC_CTX;
+    HMAC_CTX_init((HMAC_CTX *)context);
+    HMAC_CTX_copy((HMAC_CTX *)context, (HMAC_CTX *)key.context);
+}
+
+void HMAC::Key::set(const char *digest, const secure::keybytes& key)
+{
+    secure::init();
+
+    clear();
+
+    size_t len = key.size() / 8;
+
+    keytype = EVP_get_digestbyname(digest);
+    if(keytype && len) {
+        context = new ::HMAC_CTX;
+        HMAC_CTX_init((HMAC_CTX *)context);
+        HMAC_Init((HMAC_CTX *)context, *key, (int)len, (const EVP_MD *)keytype);
+    }
+}
+
+void HMAC::Key::clear(void)
+{
+    if(context) {
+        HMAC_cleanup((HMAC_CTX *)context);
+        memset(context, 0, sizeof(HMAC_CTX));
+        delete (HMAC_CTX *)context;
+        context = NULL;
+    }
+
+    keytype = NULL;
+}
+
 void HMAC::release(void)
 {
     if(context) {
@@ -63,9 +104,35 @@ bool HMAC::put(const void *address, size_t size)
     return true;
 }
 
+unsigned HMAC::batch(const char *digest, const secure::keybytes& key, size_t count, const uint8_t * const *data, const size_t *size, uint8_t **results)
+{
+    ::HMAC_CTX ctx;
+    unsigned len = 0;
+    size_t pos;
+    size_t keysize = key.size() / 8;
+
+    secure::init();
+
+    const EVP_MD *md = EVP_get_digestbyname(digest);
+    if(!md || !keysize)
+        return 0;
+
+    // the key pads are computed once, and a null key reuses them
+    HMAC_CTX_init(&ctx);
+    HMAC_Init_ex(&ctx, *key, (int)keysize, md, NULL);
+    for(pos = 0; pos < count; ++pos) {
+        if(pos)
+            HMAC_Init_ex(&ctx, NULL, 0, NULL, NULL);
+        HMAC_Update(&ctx, data[pos], size[pos]);
+        HMAC_Final(&ctx, results[pos], &len);
+    }
+    HMAC_CTX_cleanup(&ctx);
+
+    return (unsigned)EVP_MD_size(md);
+}
+
 const uint8_t *HMAC::get(void)
 {
-    unsigned count = 0;
     unsigned size = 0;
 
     if(bufsize)
@@ -81,11 +148,6 @@ const uint8_t *HMAC::get(void)
 		return NULL;
 
     bufsize = size;
-
-    while(count < bufsize) {
-        snprintf(textbuf + (count * 2), 3, "%2.2x", buffer[count]);
-        ++count;
-    }
     return buffer;
 }
 
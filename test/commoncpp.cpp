@@ -0,0 +1,171 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include <ucommon/ucommon.h>
+#include <commoncpp/commoncpp.h>
+#include <commoncpp/applog.h>
+
+#include <stdio.h>
+
+using namespace ost;
+
+static ucommon::Atomic::counter queued;
+static ucommon::Atomic::counter queuesum;
+
+class testQueue : public ThreadQueue
+{
+public:
+    testQueue(bool coalesce) : ThreadQueue("test", 0) {
+        setPooling(coalesce);
+        setTimer(TIMEOUT_INF);
+    }
+
+    void runQueue(void *data) __OVERRIDE {
+        queuesum += *((unsigned *)data);
+        ++queued;
+    }
+};
+
+class testPoster : public ucommon::JoinableThread
+{
+private:
+    testQueue *queue;
+
+public:
+    testPoster(testQueue *q) : JoinableThread() {
+        queue = q;
+    }
+
+    ~testPoster() {
+        join();
+    }
+
+    void run(void) __OVERRIDE {
+        for(unsigned pos = 0; pos < 1000; ++pos) {
+            queue->post(&pos, sizeof(pos));
+            if(!(pos % 100))
+                ucommon::Thread::yield();
+        }
+    }
+};
+
+// every post must be seen even though the queue thread never times out
+static void testPooling(bool coalesce)
+{
+    unsigned wait = 0;
+    testQueue *queue = new testQueue(coalesce);
+
+    queued.clear();
+    queuesum.clear();
+    testPoster *one = new testPoster(queue), *two = new testPoster(queue);
+    one->start();
+    two->start();
+    delete one;
+    delete two;
+
+    while(queued.get() < 2000 && wait++ < 500)
+        Thread::sleep(10);
+    assert(queued.get() == 2000);
+    assert(queuesum.get() == 999000);
+
+    // a lone post to an idle queue still wakes it
+    unsigned last = 7;
+    Thread::sleep(50);
+    queue->post(&last, sizeof(last));
+    wait = 0;
+    while(queued.get() < 2001 && wait++ < 500)
+        Thread::sleep(10);
+    assert(queued.get() == 2001);
+}
+
+class testLogger : public Thread
+{
+private:
+    AppLog *log;
+    unsigned id;
+
+public:
+    testLogger(AppLog *target, unsigned number) : Thread() {
+        log = target;
+        id = number;
+    }
+
+    ~testLogger() {
+        terminate();
+    }
+
+    void run(void) __OVERRIDE {
+        log->subscribe();
+        for(unsigned line = 0; line < 500; ++line)
+            (*log)(Slog::levelInfo) << "thread " << id << " line " << line << std::endl;
+        log->unsubscribe();
+    }
+};
+
+// every line logged through the thread rings reaches the file once
+static void testAppLog(void)
+{
+    char buf[128];
+    unsigned seen[4][500];
+    unsigned id, line, lines = 0;
+    testLogger *loggers[4];
+
+    ::remove("applog.out");
+    memset(seen, 0, sizeof(seen));
+
+    AppLog *log = new AppLog("applog.out");
+    log->logAsync();
+    log->level(Slog::levelDebug);
+    for(id = 0; id < 4; ++id) {
+        loggers[id] = new testLogger(log, id);
+        loggers[id]->start();
+    }
+    for(id = 0; id < 4; ++id)
+        delete loggers[id];
+    delete log;
+
+    FILE *fp = fopen("applog.out", "r");
+    assert(fp != NULL);
+    while(fgets(buf, sizeof(buf), fp)) {
+        const char *text = strstr(buf, "thread ");
+        assert(text != NULL);
+        assert(sscanf(text, "thread %u line %u", &id, &line) == 2);
+        assert(id < 4 && line < 500);
+        ++seen[id][line];
+        ++lines;
+    }
+    fclose(fp);
+    ::remove("applog.out");
+
+    assert(lines == 2000);
+    for(id = 0; id < 4; ++id) {
+        for(line = 0; line < 500; ++line)
+            assert(seen[id][line] == 1);
+    }
+}
+
+extern "C" int main()
+{
+    testPooling(false);
+    testPooling(true);
+    testAppLog();
+    return 0;
+}
@@ -29,6 +29,8 @@ using namespace ucommon;
 
 int main(int argc, char **argv)
 {
+    secure::init();
+
     digest_t md5("md5");
 
     md5.puts("this is some text");
@@ -47,6 +49,65 @@ int main(int argc, char **argv)
     secure::string dig = Digest::md5("this is some text");
     assert(eq("684d9d89b9de8178dcd80b7b4d018103", *dig));
 
+    // multi-block messages go through the block transforms in bulk
+    digest_t sha1("sha1"), sha256("sha256");
+    for(unsigned count = 0; count < 1000; ++count) {
+        sha1.puts("abcdefghij");
+        sha256.puts("abcdefghij");
+    }
+    assert(eq("328ef9e07dd31d535532032efd542a23e995491d", *sha1));
+    assert(eq("dce9b45e4f753351e0334bbae236195ad216b15c9b29fa0872dadd83cd10854d", *sha256));
+
+    // batches must match hashing each message on its own
+    uint8_t text[256], results[40][MAX_DIGEST_HASHSIZE / 8];
+    const uint8_t *messages[40];
+    size_t sizes[40];
+    uint8_t *outputs[40];
+    unsigned pos;
+
+    for(pos = 0; pos < sizeof(text); ++pos)
+        text[pos] = (uint8_t)(pos * 7);
+    for(pos = 0; pos < 40; ++pos) {
+        messages[pos] = text + pos;
+        sizes[pos] = pos * 5;
+        outputs[pos] = results[pos];
+    }
+
+    assert(Digest::batch("sha256", 40, messages, sizes, outputs) == 32);
+    for(pos = 0; pos < 40; ++pos) {
+        digest_t one("sha256");
+        one.put(messages[pos], sizes[pos]);
+        assert(memcmp(*one.key(), results[pos], 32) == 0);
+    }
+
+    assert(Digest::batch("sha1", 40, messages, sizes, outputs) == 20);
+    for(pos = 0; pos < 40; ++pos) {
+        digest_t one("sha1");
+        one.put(messages[pos], sizes[pos]);
+        assert(memcmp(*one.key(), results[pos], 20) == 0);
+    }
+
+    secure::keybytes mackey(text + 100, 32);
+    assert(HMAC::batch("sha256", mackey, 40, messages, sizes, outputs) == 32);
+    for(pos = 0; pos < 40; ++pos) {
+        hmac_t one("sha256", mackey);
+        one.put(messages[pos], sizes[pos]);
+        assert(memcmp(*one.key(), results[pos], 32) == 0);
+    }
+
+    // a prepared key gives the same codes when reused for each message
+    HMAC::Key prepared("sha256", mackey);
+    hmac_t reused;
+    assert(prepared);
+    for(pos = 0; pos < 40; ++pos) {
+        reused.set(prepared);
+        reused.put(messages[pos], sizes[pos]);
+        assert(memcmp(*reused.key(), results[pos], 32) == 0);
+    }
+    reused.set(prepared);
+    reused.put(messages[1], sizes[1]);
+    assert(eq(*reused, reused.key().hex()));
+
     return 0;
 }
 
@@ -38,6 +38,15 @@ public:
     unsigned value;
 };
 
+class named : public NamedObject
+{
+public:
+    inline named(NamedObject **root, const char *id, unsigned max) :
+        NamedObject(root, strdup(id), max) {}
+};
+
+typedef treemap<int> intmap;
+
 extern "C" int main()
 {
     linked_pointer<ints> ptr;
@@ -69,5 +78,44 @@ extern "C" int main()
 
     assert(ov2.value == 2);
 
+    NamedObject *names[7] = {nullptr};
+    char id[16];
+    for(unsigned pos = 0; pos < 40; ++pos) {
+        snprintf(id, sizeof(id), "name%u", pos);
+        new named(names, id, 7);
+    }
+
+    NamedIndex nidx(names, 7);
+    assert(nidx.count() == 40);
+    for(unsigned pos = 0; pos < 40; ++pos) {
+        snprintf(id, sizeof(id), "name%u", pos);
+        assert(nidx.find(id) == NamedObject::map(names, id, 7));
+    }
+    assert(nidx.find("name40") == nullptr);
+    for(unsigned pos = 0; pos < 40; pos += 2) {
+        snprintf(id, sizeof(id), "name%u", pos);
+        assert(nidx.remove(id) != nullptr);
+    }
+    assert(nidx.count() == 20);
+    for(unsigned pos = 0; pos < 40; ++pos) {
+        snprintf(id, sizeof(id), "name%u", pos);
+        assert((nidx.find(id) != nullptr) == ((pos & 1) != 0));
+    }
+    NamedObject::purge(names, 7);
+
+    int iv = 1;
+    intmap root(strdup("root"));
+    new intmap(&root, strdup("first"), iv);
+    new intmap(&root, strdup("second"));
+    intmap *third = new intmap(&root, strdup("third"));
+    new intmap(third, strdup("leaf"));
+
+    NamedIndex tidx(&root);
+    assert(tidx.count() == 3);
+    assert(tidx.find("second") == root.getChild("second"));
+    assert(tidx.find("third") == third);
+    assert(tidx.find("leaf") == nullptr);
+    assert(static_cast<intmap *>(tidx.find("first"))->get() == 1);
+
     return 0;
 }
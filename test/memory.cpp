@@ -83,6 +83,26 @@ extern "C" int main()
     int& rval = deref_pointer<int>(pval);
     assert(&rval == pval);
 
+    mempager pager(1024);
+    for(unsigned count = 0; count < 1000; ++count)
+        assert(pager.dup("small allocation") != NULL);
+    char *big = (char *)pager.alloc(4000);
+    assert(((uintptr_t)big % sizeof(void *)) == 0);
+    memset(big, 0x55, 4000);
+    assert(pager.utilization() > 50);
+    pager.purge();
+    assert(pager.pages() == 0);
+
+    pager.caching();
+    assert(pager.is_caching());
+    for(unsigned count = 0; count < 1000; ++count)
+        assert(pager.dup("cached allocation") != NULL);
+    assert(pager.pages() > 0);
+    assert(pager.utilization() > 50);
+    pager.purge();
+    assert(pager.pages() == 0);
+    assert(pager.dup("after purge") != NULL);
+
     typeref<int> iptr;
     iptr = (int)3;
     typeref<int> jptr = iptr;
@@ -176,13 +196,30 @@ extern "C" int main()
     assert(sv == 44);
     queueofints >> sv;
     assert(sv == 55);
-    assert(mapkeypath(sv) == 8779);
+    assert(mapkeypath(sv) == (size_t)(10744995191913670118ull));
 
     // flush without delay...
     sv = queueofints.pull(0);
     assert(!sv);
     assert(sv.copies() == 0);
 
+    ringref<int> ringofints(3);
+    ringofints << 17;
+    ringofints << 25;
+    ringofints << 333;
+    assert(ringofints.count() == 3);
+    assert(ringofints.push(44, 0));
+    assert(!ringofints.push(55, 0));
+    ringofints >> sv;
+    assert(sv == 17);
+    sv = ringofints.pull(0);
+    assert(sv == 25);
+    assert(ringofints.count() == 2);
+    ringofints.pull();
+    ringofints.pull();
+    sv = ringofints.pull(0);
+    assert(!sv);
+
     mapref<int,Type::Chars> map;
     map(3, "hello");
     stringref_t sr = map(3);
@@ -199,21 +236,67 @@ extern "C" int main()
 
     mapref<int,Type::Chars>::instance inst = map;
     typeref<int> kv;
-    unsigned passes = 0;
+    unsigned passes = 0, found = 0;
     while(is(inst)) {
         kv = inst.key();
+        found += *kv;
         ++inst;
         ++passes;
     }
-    assert(*kv == 7);
-    assert(passes = 2);
+    assert(found == 10);
+    assert(passes == 2);
     assert(kv.copies() == 2);
+    inst = mapref<int,Type::Chars>::instance();
 
     map.remove(7);
-    map(9, "9");
-    assert(map.used() == 2);
     sr = map(7);
     assert(*sr == nullptr);
+    map(7, "7");
+    assert(map.used() == 2);
+    map(9, "9");
+    assert(map.count() == 3);
+
+    mapref<int,int> keyed(64);
+    for(int pos = 0; pos < 10000; ++pos)
+        keyed(pos, pos * 3);
+    assert(keyed.count() == 10000);
+    assert(*keyed(4321) == 12963);
+    keyed.remove(4321);
+    assert(keyed.count() == 9999);
+    mapref<int,int>::instance walk = keyed;
+    passes = 0;
+    while(is(walk)) {
+        ++walk;
+        ++passes;
+    }
+    assert(passes == 9999);
+
+    typeref_epoch published;
+    mapref<int,int> routes(8);
+    routes(1, 10);
+    routes(2, 20);
+    routes.publish(published);
+    mapref<int,int> snapshot = published;
+    assert(*snapshot(2) == 20);
+    routes(3, 30);
+    assert(*routes(3) == 30);
+    assert(snapshot.count() == 2);
+    {
+        typeref_epoch::reader epoch;
+        routes.publish(published);
+        assert(typeref_epoch::reclaim() == 0);
+    }
+    assert(typeref_epoch::reclaim() == 1);
+    snapshot = published;
+    assert(*snapshot(3) == 30);
+    assert(*snapshot(1) == 10);
+
+    arrayref<int> table(4, 5);
+    table.publish(published);
+    arrayref<int> frozen = published;
+    table(1, 7);
+    assert(*table[1] == 7);
+    assert(*frozen[1] == 5);
 
     listref<int> intlist;
     intlist << 3 << 5 << 7 << 9;
@@ -279,5 +362,26 @@ extern "C" int main()
     s6 = "";
     s7 = "";
     assert(release_later.purge() == 2);
+
+    typeref<int, pooled_release> pv1(1);
+    typeref<int, pooled_release> pv2 = pv1;
+    assert(pv1.copies() == 2);
+    const int *pooled = pv1();
+    pv1.clear();
+    pv2.clear();
+    typeref<int, pooled_release> pv3(3);
+    assert(pv3() == pooled && *pv3 == 3);
+
+    char longtext[1024];
+    memset(longtext, 'x', sizeof(longtext) - 1);
+    longtext[sizeof(longtext) - 1] = 0;
+    stringref<pooled_release> ps1 = "short", ps2 = longtext;
+    assert(eq(ps1, "short") && ps2.len() == sizeof(longtext) - 1);
+
+    typeref<int, local_release> lv1(4);
+    typeref<int, local_release> lv2 = lv1;
+    assert(lv2.copies() == 2 && *lv2 == 4);
+    lv1.clear();
+    assert(lv2.copies() == 1);
     return 0;
 }
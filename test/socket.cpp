@@ -34,6 +34,189 @@ static Socket::address testing6("44:022:66::1", 4444);
 static Socket::address localhost6("::1", 4444);
 #endif
 
+class testReactor : public TCPReactor
+{
+public:
+    testReactor() : TCPReactor("127.0.0.1", "4446", 2) {};
+
+    ~testReactor() {
+        stop();
+    }
+
+    void input(connection *client) {
+        char buf[64];
+        while(client->readline(buf, sizeof(buf))) {
+            client->writes(buf);
+            client->writes("\n");
+        }
+    }
+};
+
+static void testEcho(void)
+{
+    char buf[64];
+    testReactor server;
+
+    if(server.handle() == INVALID_SOCKET)
+        return;
+
+    server.start();
+    Socket::address peer("127.0.0.1", 4446);
+    Socket client(*peer);
+    assert(client.writes("hello\r\nworld\n") == 13);
+    assert(Socket::readline(*client, buf, sizeof(buf), 2000) == 6);
+    assert(eq(buf, "hello"));
+    assert(Socket::readline(*client, buf, sizeof(buf), 2000) == 6);
+    assert(eq(buf, "world"));
+    assert(server.count() == 1);
+}
+
+static void testTable(void)
+{
+    cidr::policy *list = NULL;
+    cidr all(&list, "0.0.0.0/0");
+    cidr net10(&list, "10.0.0.0/8");
+    cidr net10a(&list, "10.1.0.0/16");
+    cidr net10b(&list, "10.1.2.0/24");
+    cidr other(&list, "192.168.0.0/16");
+    cidr host(&list, "10.1.2.3/32");
+    cidr loop6(&list, "::1/128");
+    cidr site6(&list, "2001:db8::/32");
+    cidr::table lookup(list);
+
+    Socket::address a1("10.1.2.3"), a2("10.1.2.4"), a3("10.9.9.9");
+    Socket::address a4("172.16.0.1"), a5("2001:db8::5");
+    const struct sockaddr *tests[] = {
+        a1.get(AF_INET), a2.get(AF_INET), a3.get(AF_INET), a4.get(AF_INET),
+        a5.get(AF_INET6)};
+
+    assert(lookup.size() == 8);
+    for(unsigned pos = 0; pos < sizeof(tests) / sizeof(tests[0]); ++pos) {
+        if(!tests[pos])
+            continue;
+        assert(lookup.find(tests[pos]) == cidr::find(list, tests[pos]));
+        assert(lookup.container(tests[pos]) == cidr::container(list, tests[pos]));
+    }
+
+    assert(lookup.find(a1.get(AF_INET)) == &host);
+    assert(lookup.find(a2.get(AF_INET)) == &net10b);
+    assert(lookup.find(a4.get(AF_INET)) == NULL);
+    assert(lookup.container(a2.get(AF_INET)) == &all);
+
+    assert(lookup.remove(&net10b));
+    assert(!lookup.remove(&net10b));
+    assert(lookup.find(a2.get(AF_INET)) == &net10a);
+    assert(lookup.find(a1.get(AF_INET)) == &host);
+    lookup.insert(&net10b);
+    assert(lookup.find(a2.get(AF_INET)) == &net10b);
+    assert(lookup.size() == 8);
+}
+
+#ifndef _MSWINDOWS_
+static void testReader(void)
+{
+    char buf[8], ch;
+    size_t len;
+    int pair[2];
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, pair))
+        return;
+
+    Socket::reader lines(pair[0], 16);
+    assert(::write(pair[1], "one\r\ntwo\n\nthree\n", 16) == 16);
+    assert(eq(lines.getline(&len), "one") && len == 3);
+    assert(eq(lines.getline(&len), "two") && len == 3);
+    assert(lines.readline(buf, sizeof(buf)) == 1);
+    assert(lines.readline(buf, 4) == 3);
+    assert(eq(buf, "thr"));
+    assert(lines.peek(&ch, 1) == 1 && ch == 'e');
+    assert(lines.readline(buf, sizeof(buf)) == 3);
+    assert(eq(buf, "ee"));
+
+    Socket sock(pair[0]);
+    sock.buffering(32);
+    assert(sock.is_buffered());
+    assert(::write(pair[1], "last\nleft", 9) == 9);
+    ::close(pair[1]);
+    assert(sock.readline(buf, 4) == 3);
+    assert(eq(buf, "las"));
+    ch = 0;
+    assert(sock.peek(&ch, 1) == 1 && ch == 't');
+    assert(sock.readline(buf, sizeof(buf)) == 2);
+    assert(eq(buf, "t"));
+    assert(sock.readline(buf, sizeof(buf)) == 4);
+    assert(eq(buf, "left"));
+    assert(sock.readline(buf, sizeof(buf)) == 0);
+}
+
+static void testBatch(void)
+{
+    char buf[4][16];
+    int pair[2];
+    Socket::datagram msgs[4];
+
+    if(socketpair(AF_UNIX, SOCK_DGRAM, 0, pair))
+        return;
+
+    Socket out(pair[0]), in(pair[1]);
+    memset(msgs, 0, sizeof(msgs));
+    msgs[0].data = (void *)"one";
+    msgs[0].size = 3;
+    msgs[1].data = (void *)"two";
+    msgs[1].size = 3;
+    msgs[2].data = (void *)"three";
+    msgs[2].size = 5;
+    assert(out.writemsgs(msgs, 3) == 3);
+    assert(msgs[2].result == 5);
+
+    for(unsigned pos = 0; pos < 4; ++pos) {
+        msgs[pos].data = buf[pos];
+        msgs[pos].size = sizeof(buf[pos]);
+    }
+    assert(in.readmsgs(msgs, 4) == 3);
+    assert(msgs[1].result == 3 && !memcmp(buf[1], "two", 3));
+    assert(msgs[2].result == 5 && !memcmp(buf[2], "three", 5));
+
+    struct iovec iov[2];
+    iov[0].iov_base = (void *)"head";
+    iov[0].iov_len = 4;
+    iov[1].iov_base = (void *)"tail";
+    iov[1].iov_len = 4;
+    assert(out.writev(iov, 2) == 8);
+    iov[0].iov_base = buf[0];
+    iov[0].iov_len = 2;
+    iov[1].iov_base = buf[1];
+    iov[1].iov_len = 6;
+    assert(in.readv(iov, 2) == 8);
+    assert(!memcmp(buf[0], "he", 2) && !memcmp(buf[1], "adtail", 6));
+}
+
+static void testSendfile(void)
+{
+    char buf[32];
+    int pair[2];
+    fsys file;
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, pair))
+        return;
+
+    Socket out(pair[0]), in(pair[1]);
+    fsys::erase("sendfile.tmp");
+    file.open("sendfile.tmp", 0640, fsys::REWRITE);
+    assert(is(file));
+    assert(file.write("0123456789abcdef", 16) == 16);
+
+    assert(out.sendfile(file, 4, 8) == 8);
+    assert(out.sendfile(file, 12, 100) == 4);
+    assert(out.sendfile(file, 16, 10) == 0);
+    assert(in.readfrom(buf, sizeof(buf)) == 12);
+    assert(!memcmp(buf, "456789abcdef", 12));
+
+    file.close();
+    fsys::erase("sendfile.tmp");
+}
+#endif
+
 extern "C" int main()
 {
     struct sockaddr_internet addr;
@@ -98,5 +281,13 @@ extern "C" int main()
         assert(0 == strcmp(addrbuf, "44:22:66::1"));
     }
 #endif
+
+    testEcho();
+    testTable();
+#ifndef _MSWINDOWS_
+    testReader();
+    testBatch();
+    testSendfile();
+#endif
     return 0;
 }
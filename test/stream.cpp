@@ -41,6 +41,148 @@ public:
     }
 };
 
+class BulkOut: public JoinableThread
+{
+public:
+    BulkOut() : JoinableThread() {};
+
+    ~BulkOut() {
+        join();
+    }
+
+    void run() {
+        static char data[200000];
+        for(unsigned pos = 0; pos < sizeof(data); ++pos)
+            data[pos] = (char)(pos % 251);
+
+        Socket::address localhost("127.0.0.1", 9001);
+        tcpstream tcp(localhost);
+        tcp.buffering(16384);
+        tcp << "bulk" << endl;
+        tcp.write(data, sizeof(data));
+        tcp.flush();
+
+        // disconnect resets the connection, so wait until all is read
+        char line[32];
+        tcp.getline(line, sizeof(line));
+        tcp.close();
+    }
+};
+
+static void testBulk(void)
+{
+    static char data[200000];
+    char line[32];
+    BulkOut thread;
+    TCPServer sock("127.0.0.1", "9001");
+
+    thread.start();
+    assert(sock.wait(1000));
+    tcpstream tcp(&sock);
+    tcp.buffering(16384);
+    assert(tcp.is_bulk());
+    tcp.getline(line, sizeof(line));
+    assert(eq(line, "bulk"));
+    tcp.read(data, sizeof(data));
+    assert(tcp.gcount() == (std::streamsize)sizeof(data));
+    for(unsigned pos = 0; pos < sizeof(data); ++pos)
+        assert(data[pos] == (char)(pos % 251));
+    tcp << "done" << endl;
+    tcp.close();
+}
+
+static void testMapped(void)
+{
+    char line[200];
+    filestream out("stream.tmp", 0644, fsys::WRONLY);
+    out << "first line" << std::endl << "second 42" << std::endl;
+    out.close();
+
+    filestream in("stream.tmp", fsys::MAPPED);
+    assert(in.is_mapped());
+    in.getline(line, sizeof(line));
+    assert(eq(line, "first line"));
+    in.getline(line, sizeof(line));
+    assert(eq(line, "second 42"));
+    assert(!in.getline(line, sizeof(line)));
+
+    in.clear();
+    in.rewind();
+    int value = 0;
+    in >> line >> line >> line >> value;
+    assert(eq(line, "second") && value == 42);
+
+    in.clear();
+    in.seek(6);
+    in.getline(line, sizeof(line));
+    assert(eq(line, "line"));
+    in.close();
+    fsys::erase("stream.tmp");
+}
+
+static void testAsync(void)
+{
+    char line[200];
+    AsyncIO engine;
+    filestream out("stream.tmp", 0644, fsys::WRONLY, 64);
+    out.writeback(&engine);
+    for(unsigned pos = 0; pos < 100; ++pos)
+        out << "line " << pos << std::endl;
+    out.close();
+
+    fsys fs("stream.tmp", fsys::RDONLY);
+    AsyncIO::request first, second;
+    char buf1[7], buf2[7];
+    assert(engine.read(&first, fs, buf1, 6, 0));
+    assert(engine.read(&second, fs, buf2, 6, 7));
+    assert(!engine.read(&first, fs, buf1, 6, 0));
+    engine.submit();
+    assert(engine.wait(&first) == 6 && engine.wait(&second) == 6);
+    buf1[6] = buf2[6] = 0;
+    assert(eq(buf1, "line 0") && eq(buf2, "line 1"));
+    fs.close();
+
+    filestream in("stream.tmp", fsys::RDONLY);
+    unsigned count = 0;
+    while(in.getline(line, sizeof(line))) {
+        char expect[32];
+        snprintf(expect, sizeof(expect), "line %u", count++);
+        assert(eq(line, expect));
+    }
+    assert(count == 100);
+    in.close();
+    fsys::erase("stream.tmp");
+}
+
+static void testWalker(void)
+{
+    const char *files[] = {"walk.tmp/a/b/z", "walk.tmp/a/y", "walk.tmp/x", "walk.tmp/.h/w"};
+    StringPager list;
+    DirWalker walker(4);
+
+    dir::create("walk.tmp", 0755);
+    dir::create("walk.tmp/a", 0755);
+    dir::create("walk.tmp/a/b", 0755);
+    dir::create("walk.tmp/.h", 0755);
+    for(unsigned pos = 0; pos < 4; ++pos) {
+        fsys fs(files[pos], 0644, fsys::WRONLY);
+        fs.close();
+    }
+
+    assert(walker.walk("walk.tmp", list) == 3);
+    assert(eq(list[0u], files[0]) && eq(list[1u], files[1]) && eq(list[2u], files[2]));
+
+    DirWalker shallow(2, 1);
+    assert(shallow.walk("walk.tmp") == 2);
+
+    for(unsigned pos = 0; pos < 4; ++pos)
+        fsys::erase(files[pos]);
+    dir::remove("walk.tmp/.h");
+    dir::remove("walk.tmp/a/b");
+    dir::remove("walk.tmp/a");
+    dir::remove("walk.tmp");
+}
+
 int main(int argc, char *argv[])
 {
     ThreadOut thread;
@@ -63,6 +205,10 @@ int main(int argc, char *argv[])
         String s;
         std::null >> s;
 
+        testBulk();
+        testMapped();
+        testAsync();
+        testWalker();
         return 0;
     }
     assert(0);
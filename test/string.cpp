@@ -132,9 +132,15 @@ extern "C" int main()
     stringref_t k1 = "testing phrase";
     stringref_t k2 = "testing phrase";
 
-    assert(mapkeypath(k1) == (size_t)(70252474772234));
+    assert(mapkeypath(k1) == (size_t)(9821028144720518011ull));
     assert(mapkeypath(k1) == mapkeypath(k2));
 
+    assert(Hash::get("", 0, 0) == 0x93228a4de0eec5a2ull);
+    assert(Hash::get("a", 1, 1) == 0xc5bac3db178713c4ull);
+    assert(Hash::get("abc", 3, 2) == 0xa97f2f7b1d9b3314ull);
+    assert(Hash::get("sip:1000@example.com") == Hash::get("sip:1000@example.com", 20));
+    assert(Hash::get("sip:1000@example.com", 20, 1) != Hash::get("sip:1000@example.com", 20, 2));
+
     mapref<Type::Chars,Type::Chars> map;
     map("hello", "goodbye");
     cvs = map("hello");
@@ -56,6 +56,41 @@ public:
     };
 };
 
+static ringref<int> ring(16);
+static Atomic::counter ringsum;
+
+class ringProducer : public JoinableThread
+{
+public:
+    ringProducer() : JoinableThread() {};
+
+    ~ringProducer() {
+        join();
+    };
+
+    void run(void) {
+        for(int value = 1; value <= 10000; ++value)
+            ring << value;
+    };
+};
+
+class ringConsumer : public JoinableThread
+{
+public:
+    ringConsumer() : JoinableThread() {};
+
+    ~ringConsumer() {
+        join();
+    };
+
+    void run(void) {
+        for(unsigned count = 0; count < 10000; ++count) {
+            typeref<int> value = ring.pull();
+            ringsum += *value;
+        }
+    };
+};
+
 extern "C" int main()
 {
     time_t now, later;
@@ -76,6 +111,31 @@ extern "C" int main()
     time(&later);
     assert(later >= now + 1);
 
+    assert(Mutex::stripes() > 1);
+    assert(Mutex::protect(&now));
+    assert(Mutex::release(&now));
+    assert(!Mutex::release(&now));
+    assert(RWLock::reader::lock(&now));
+    assert(RWLock::reader::lock(&now));
+    assert(!RWLock::writer::lock(&now, 0));
+    assert(RWLock::release(&now));
+    assert(RWLock::release(&now));
+    assert(RWLock::writer::lock(&now, 0));
+    assert(RWLock::release(&now));
+
+    ringConsumer *c1 = new ringConsumer(), *c2 = new ringConsumer();
+    ringProducer *p1 = new ringProducer(), *p2 = new ringProducer();
+    c1->start();
+    c2->start();
+    p1->start();
+    p2->start();
+    delete p1;
+    delete p2;
+    delete c1;
+    delete c2;
+    assert(ringsum.get() == 2 * 50005000);
+    assert(ring.count() == 0);
+
     time(&now);
     TimedEvent evt;
     evt.wait(2000);
@@ -37,6 +37,10 @@
 #cmakedefine HAVE_REGEX_H 1
 #cmakedefine HAVE_SYS_INOTIFY_H 1
 #cmakedefine HAVE_SYS_EVENT_H 1
+#cmakedefine HAVE_SYS_EPOLL_H 1
+#cmakedefine HAVE_LINUX_IO_URING_H 1
+#cmakedefine HAVE_SYS_UIO_H 1
+#cmakedefine HAVE_SYS_SENDFILE_H 1
 #cmakedefine HAVE_SYSLOG_H 1
 #cmakedefine HAVE_LIBINTL_H 1
 #cmakedefine HAVE_NETINET_IN_H 1
@@ -73,6 +77,9 @@
 #cmakedefine HAVE_SHL_LOAD 1
 #cmakedefine HAVE_SHM_OPEN 1
 #cmakedefine HAVE_SOCKETPAIR 1
+#cmakedefine HAVE_SENDMMSG 1
+#cmakedefine HAVE_RECVMMSG 1
+#cmakedefine HAVE_COPY_FILE_RANGE 1
 #define HAVE_STDEXCEPT 1        /* cannot seem to test in cmake... */
 #cmakedefine HAVE_STRLCPY 1
 #cmakedefine HAVE_STRICMP 1
@@ -16,7 +16,7 @@
 # Please submit bugfixes or comments via http://bugs.opensuse.org/
 #
 
-%define libname	libucommon8
+%define libname	libucommon9
 %if %{_target_cpu} == "x86_64"
 %define	build_docs	1
 %else
@@ -125,6 +125,7 @@ chmod 0755 %{buildroot}%{_bindir}/commoncpp-config
 %{_bindir}/zerofill
 %{_bindir}/pdetach
 %{_bindir}/urlout
+%{_bindir}/keyhash
 %{_mandir}/man1/args.*
 %{_mandir}/man1/car.*
 %{_mandir}/man1/scrub-files.*
@@ -134,6 +135,7 @@ chmod 0755 %{buildroot}%{_bindir}/commoncpp-config
 %{_mandir}/man1/keywait.*
 %{_mandir}/man1/pdetach.*
 %{_mandir}/man1/urlout.*
+%{_mandir}/man1/keyhash.*
 
 %files devel
 %defattr(-,root,root,-)
@@ -381,14 +381,41 @@ static void streamdecode(FILE *fp, const char *path)
     }
 }
 
+class walker : public DirWalker
+{
+protected:
+    bool visit(const char *path, bool directory) __OVERRIDE {
+        return is(hidden) || DirWalker::visit(path, directory);
+    }
+};
+
 static void scan(string_t path, string_t prefix)
 {
     char filename[128];
     string_t filepath;
     string_t name;
     string_t subdir;
-    dir_t dir(path);
 
+    // recursive scans walk the tree in parallel, then archive in order
+    if(is(recursive) || is(altrecursive)) {
+        walker tree;
+        StringPager files;
+        size_t len = path.len();
+        tree.walk(path, files);
+        for(char **list = files.list(); *list; ++list) {
+            const char *cp = *list + len;
+            while(*cp == '/')
+                ++cp;
+            if(prefix[0])
+                name ^= prefix + str("/") + str(cp);
+            else
+                name ^= str(cp);
+            encodefile(*list, *name);
+        }
+        return;
+    }
+
+    dir_t dir(path);
     while(is(dir) && dir.read(filename, sizeof(filename))) {
         if(*filename == '.' && (filename[1] == '.' || !filename[1]))
             continue;
@@ -402,12 +429,8 @@ static void scan(string_t path, string_t prefix)
         else
             name ^= str(filename);
 
-        if(fsys::is_dir(filepath)) {
-            if(is(recursive) || is(altrecursive))
-                scan(filepath, name);
-            else
-                report(*filepath, EISDIR);
-        }
+        if(fsys::is_dir(filepath))
+            report(*filepath, EISDIR);
         else
             encodefile(*filepath, *name);
     }
@@ -0,0 +1,225 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+#include <arpa/inet.h>
+
+using namespace ucommon;
+
+static shell::flagopt helpflag('h',"--help",    _TEXT("display this list"));
+static shell::flagopt althelp('?', NULL, NULL);
+static shell::numericopt buckets('b', "--buckets", _TEXT("hash table size (1021)"), "count", 1021);
+static shell::stringopt type('t', "--type", _TEXT("key type (names)"), "names|map|hosts", "names");
+
+typedef enum {NAMES, MAP, HOSTS} keytype_t;
+
+class keyset
+{
+public:
+    char **keys;
+    struct sockaddr_storage *hosts;
+    unsigned count, alloc;
+
+    keyset();
+    ~keyset();
+
+    void add(const char *key);
+};
+
+static keytype_t mode = NAMES;
+static const char *argv0 = "keyhash";
+
+keyset::keyset()
+{
+    keys = NULL;
+    hosts = NULL;
+    count = alloc = 0;
+}
+
+keyset::~keyset()
+{
+    for(unsigned pos = 0; pos < count; ++pos)
+        ::free(keys[pos]);
+    ::free(keys);
+    ::free(hosts);
+}
+
+void keyset::add(const char *key)
+{
+    if(count == alloc) {
+        alloc = alloc ? alloc * 2 : 1024;
+        keys = (char **)::realloc(keys, sizeof(char *) * alloc);
+        hosts = (struct sockaddr_storage *)::realloc(hosts, sizeof(struct sockaddr_storage) * alloc);
+        if(!keys || !hosts)
+            shell::errexit(3, "*** %s: %s\n", argv0, _TEXT("out of memory"));
+    }
+
+    if(mode == HOSTS) {
+        struct sockaddr_storage *addr = &hosts[count];
+        memset(addr, 0, sizeof(struct sockaddr_storage));
+#ifdef  AF_INET6
+        if(strchr(key, ':')) {
+            struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)addr;
+            in6->sin6_family = AF_INET6;
+            if(inet_pton(AF_INET6, key, &in6->sin6_addr) < 1)
+                return;
+        }
+        else
+#endif
+        {
+            struct sockaddr_in *in = (struct sockaddr_in *)addr;
+            in->sin_family = AF_INET;
+            if(inet_pton(AF_INET, key, &in->sin_addr) < 1)
+                return;
+        }
+    }
+    keys[count++] = strdup(key);
+}
+
+// the key hashes used before the shared seeded hash, for comparison
+
+static unsigned legacy(keyset& set, unsigned pos, unsigned size)
+{
+    const char *id = set.keys[pos];
+    unsigned val = 0;
+    size_t path = 1;
+    caddr_t cp;
+    unsigned len;
+
+    switch(mode) {
+    case MAP:
+        while(*id)
+            path ^= (path << 3) ^ (uint8_t)*(id++);
+        return (unsigned)(path % size);
+    case HOSTS:
+        if(set.hosts[pos].ss_family == AF_INET) {
+            cp = (caddr_t)(&((struct sockaddr_in *)(&set.hosts[pos]))->sin_addr);
+            len = 4;
+        }
+        else {
+            cp = (caddr_t)(&((struct sockaddr_in6 *)(&set.hosts[pos]))->sin6_addr);
+            len = 16;
+        }
+        while(len--) {
+            val = val << 1;
+            val ^= cp[len];
+        }
+        return val % size;
+    default:
+        while(*id)
+            val = (val << 1) ^ (*(id++) & 0x1f);
+        return val % size;
+    }
+}
+
+static unsigned current(keyset& set, unsigned pos, unsigned size)
+{
+    const char *id = set.keys[pos];
+    size_t path = 1;
+
+    switch(mode) {
+    case MAP:
+        return (unsigned)(MapRef::index(path, (const uint8_t *)id, strlen(id)) % size);
+    case HOSTS:
+        return Socket::keyhost((const struct sockaddr *)(&set.hosts[pos]), size);
+    default:
+        return NamedObject::keyindex(id, size);
+    }
+}
+
+static void report(const char *name, keyset& set, unsigned size, unsigned (*index)(keyset&, unsigned, unsigned))
+{
+    unsigned *chains = new unsigned[size];
+    unsigned used = 0, longest = 0;
+    double probes = 0.0;
+
+    memset(chains, 0, sizeof(unsigned) * size);
+    for(unsigned pos = 0; pos < set.count; ++pos)
+        ++chains[index(set, pos, size)];
+
+    for(unsigned pos = 0; pos < size; ++pos) {
+        unsigned chain = chains[pos];
+        if(!chain)
+            continue;
+        ++used;
+        if(chain > longest)
+            longest = chain;
+        // average compares to find each key of a chain
+        probes += (double)chain * (chain + 1) / 2.0;
+    }
+
+    if(set.count)
+        probes /= set.count;
+
+    shell::printf("%-8s %8u %8u %8u %8u %8.2f\n", name, set.count, size, used, longest, probes);
+    delete[] chains;
+}
+
+static void load(keyset& set, FILE *fp)
+{
+    char buffer[1024];
+
+    while(fgets(buffer, sizeof(buffer), fp) != NULL) {
+        char *key = String::strip(buffer, " \t\r\n");
+        if(*key)
+            set.add(key);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    shell::bind("keyhash");
+    shell args(argc, argv);
+    argv0 = args.argv0();
+    keyset set;
+
+    if(is(helpflag) || is(althelp)) {
+        printf("%s\n", _TEXT("Usage: keyhash [options] [files...]"));
+        printf("%s\n\n", _TEXT("Report hash bucket distribution of keys"));
+        printf("%s\n", _TEXT("Options:"));
+        shell::help();
+        printf("\n%s\n", _TEXT("Report bugs to dyfet@gnu.org"));
+        return 0;
+    }
+
+    if(eq(*type, "map"))
+        mode = MAP;
+    else if(eq(*type, "hosts"))
+        mode = HOSTS;
+    else if(!eq(*type, "names"))
+        shell::errexit(2, "*** %s: %s: %s\n", argv0, *type, _TEXT("unknown key type"));
+
+    if(*buckets < 2)
+        shell::errexit(2, "*** %s: %s\n", argv0, _TEXT("too few buckets"));
+
+    if(!args())
+        load(set, stdin);
+
+    for(unsigned pos = 0; pos < (unsigned)args(); ++pos) {
+        FILE *fp = fopen(args[pos], "r");
+        if(!fp)
+            shell::errexit(1, "*** %s: %s: %s\n", argv0, args[pos], _TEXT("cannot open"));
+        load(set, fp);
+        fclose(fp);
+    }
+
+    unsigned size = (unsigned)*buckets;
+    shell::printf("%-8s %8s %8s %8s %8s %8s\n", "hash", "keys", "buckets", "used", "longest", "probes");
+    report("legacy", set, size, &legacy);
+    report("current", set, size, &current);
+    return 0;
+}
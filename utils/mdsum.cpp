@@ -27,12 +27,16 @@ static shell::stringopt hash('d', "--digest", _TEXT("digest method (md5)"), "met
 static shell::flagopt recursive('R', "--recursive", _TEXT("recursive directory scan"));
 static shell::flagopt altrecursive('r', NULL, NULL);
 static shell::flagopt hidden('s', "--hidden", _TEXT("show hidden files"));
+static shell::numericopt jobs('j', "--jobs", _TEXT("files to hash concurrently"), "count", 1);
+
+// size of read blocks when hashing concurrently
+#define BLOCK_SIZE  (256l * 1024l)
 
 static int exit_code = 0;
 static const char *argv0 = "md";
 static digest_t md;
 
-static void result(const char *path, int code)
+static void result(const char *path, int code, const char *sum = NULL)
 {
     const char *err = _TEXT("i/o error");
 
@@ -81,8 +85,12 @@ static void result(const char *path, int code)
     if(!code) {
         if(!path)
             path="-";
-        secure::string sum = *md;
-        shell::printf("%s %s\n", *sum, path);
+        if(sum) {
+            shell::printf("%s %s\n", sum, path);
+            return;
+        }
+        secure::string text = *md;
+        shell::printf("%s %s\n", *text, path);
         return;
     }
 
@@ -113,6 +121,11 @@ static void digest(const char *path = NULL)
             return;
         }
 
+        if(fsys::is_dir(&ino)) {
+            result(path, EISDIR);
+            return;
+        }
+
         fs.open(path, fsys::STREAM);
     }
     else
@@ -135,12 +148,189 @@ static void digest(const char *path = NULL)
     md.reset();
 }
 
-static void scan(String path, bool top = true)
+// a file to hash concurrently, reported in the order it was queued
+class task : public OrderedObject
+{
+public:
+    char *path;
+    int error;
+    secure::string sum;
+    bool done;
+
+    task(OrderedIndex *index, const char *filename, int code = 0);
+    ~task();
+};
+
+// hashes queued files, reading the next block while hashing the last one
+class hasher : public JoinableThread
+{
+private:
+    digest_t md;
+    uint8_t *buffer[2];
+
+    void compute(task *item);
+
+public:
+    hasher();
+    ~hasher();
+
+    void run(void) __OVERRIDE;
+};
+
+static OrderedIndex queue;
+static task *next = NULL;
+static ConditionMutex locking;
+static ConditionVar ready(&locking);
+static AsyncIO *engine = NULL;
+
+task::task(OrderedIndex *index, const char *filename, int code) :
+OrderedObject(index)
+{
+    path = strdup(filename);
+    error = code;
+    done = (code != 0);
+}
+
+task::~task()
+{
+    ::free(path);
+}
+
+hasher::hasher() :
+JoinableThread()
+{
+    md = *hash;
+    if(!is(hash) && Digest::has(argv0))
+        md = argv0;
+
+    // aligned blocks for the read and the hash sides of the pipeline
+    for(unsigned pos = 0; pos < 2; ++pos) {
+#ifndef _MSWINDOWS_
+        void *mem = NULL;
+        if(posix_memalign(&mem, 4096, BLOCK_SIZE))
+            mem = NULL;
+        buffer[pos] = (uint8_t *)mem;
+#else
+        buffer[pos] = (uint8_t *)malloc(BLOCK_SIZE);
+#endif
+        if(!buffer[pos])
+            shell::errexit(3, "*** %s: %s\n", argv0, _TEXT("no memory"));
+    }
+}
+
+hasher::~hasher()
+{
+    join();
+    ::free(buffer[0]);
+    ::free(buffer[1]);
+}
+
+void hasher::compute(task *item)
+{
+    fsys::fileinfo_t ino;
+    AsyncIO::request req;
+    fsys fs;
+    fsys::offset_t pos = 0;
+    unsigned current = 0;
+    ssize_t size;
+
+    item->error = fsys::info(item->path, &ino);
+    if(!item->error && fsys::is_sys(&ino))
+        item->error = EBADF;
+    else if(!item->error && fsys::is_dir(&ino))
+        item->error = EISDIR;
+
+    if(item->error)
+        return;
+
+    fs.open(item->path, fsys::STREAM);
+    if(!is(fs)) {
+        item->error = fs.err();
+        return;
+    }
+
+    engine->read(&req, fs, buffer[current], BLOCK_SIZE, pos);
+    for(;;) {
+        size = engine->wait(&req);
+        if(size < 1) {
+            if(size < 0)
+                item->error = req.err();
+            break;
+        }
+        pos += size;
+        engine->read(&req, fs, buffer[current ^ 1], BLOCK_SIZE, pos);
+        engine->submit();
+        md.put(buffer[current], size);
+        current ^= 1;
+    }
+
+    fs.close();
+    if(!item->error) {
+        secure::string text = *md;
+        item->sum.set(*text);
+    }
+    md.reset();
+}
+
+void hasher::run(void)
+{
+    for(;;) {
+        locking.lock();
+        task *item = next;
+        while(item && item->done)
+            item = static_cast<task *>(item->getNext());
+        if(item)
+            next = static_cast<task *>(item->getNext());
+        else
+            next = NULL;
+        locking.unlock();
+
+        if(!item)
+            return;
+
+        compute(item);
+
+        locking.lock();
+        item->done = true;
+        ready.broadcast();
+        locking.unlock();
+    }
+}
+
+class walker : public DirWalker
+{
+protected:
+    bool visit(const char *path, bool directory) __OVERRIDE {
+        return is(hidden) || DirWalker::visit(path, directory);
+    }
+};
+
+static void process(const char *path, int code = 0)
+{
+    if(*jobs > 1)
+        new task(&queue, path, code);
+    else if(code)
+        result(path, code);
+    else
+        digest(path);
+}
+
+static void scan(String path)
 {
     char filename[128];
     string_t filepath;
-    dir_t dir(path);
 
+    // recursive scans walk the tree in parallel, then digest in order
+    if(is(recursive) || is(altrecursive)) {
+        walker tree;
+        StringPager files;
+        tree.walk(path, files);
+        for(char **list = files.list(); *list; ++list)
+            process(*list);
+        return;
+    }
+
+    dir_t dir(path);
     while(is(dir) && dir.read(filename, sizeof(filename))) {
         if(*filename == '.' && (filename[1] == '.' || !filename[1]))
             continue;
@@ -149,14 +339,10 @@ static void scan(String path, bool top = true)
             continue;
 
         filepath = str(path) + str("/") + str(filename);
-        if(fsys::is_dir(filepath)) {
-            if(is(recursive) || is(altrecursive))
-                scan(filepath, false);
-            else
-                result(filepath, EISDIR);
-        }
+        if(fsys::is_dir(filepath))
+            process(filepath, EISDIR);
         else
-            digest(filepath);
+            process(filepath);
     }
 }
 
@@ -195,7 +381,36 @@ int main(int argc, char **argv)
         if(fsys::is_dir(args[count]))
             scan(str(args[count++]));
         else
-            digest(args[count++]);
+            process(args[count++]);
+    }
+
+    if(*jobs > 1 && queue.begin()) {
+        unsigned pos, workers = (unsigned)(*jobs);
+        hasher **pool = new hasher *[workers];
+        AsyncIO aio(workers * 2, workers);
+
+        engine = &aio;
+        next = static_cast<task *>(queue.begin());
+        for(pos = 0; pos < workers; ++pos) {
+            pool[pos] = new hasher();
+            pool[pos]->start();
+        }
+
+        // report in queued order as each file completes
+        linked_pointer<task> tp = queue.begin();
+        while(is(tp)) {
+            locking.lock();
+            while(!tp->done)
+                ready.wait();
+            locking.unlock();
+            result(tp->path, tp->error, tp->error ? NULL : *(tp->sum));
+            tp.next();
+        }
+
+        for(pos = 0; pos < workers; ++pos)
+            delete pool[pos];
+        delete[] pool;
+        engine = NULL;
     }
 
     return exit_code;